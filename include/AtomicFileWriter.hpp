@@ -0,0 +1,83 @@
+#ifndef ATOMIC_FILE_WRITER_HPP
+#define ATOMIC_FILE_WRITER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+// Output stream that replaces a file crash-safely. Everything goes to a
+// temporary file in the target's directory; commit() flushes and fsyncs it
+// and renames it over the target, so readers (and a crash at any point) see
+// either the old or the complete new content, never a truncated file. The
+// temporary file is removed if the writer is destroyed without a commit.
+// Failures are reported by isOpen(), the stream state and commit(); the
+// caller says which file could not be written.
+//
+// Output is staged in a large page-aligned buffer and written with write(2),
+// and copyFrom() moves unchanged byte ranges of an existing file in-kernel
+// with copy_file_range instead of passing them through user space. Other
+// platforms write through std::ofstream and rename with std::filesystem,
+// without the fsyncs.
+class AtomicFileWriter : public std::ostream {
+public:
+    explicit AtomicFileWriter(const std::string& path, size_t bufferSize = size_t(1) << 20);
+    ~AtomicFileWriter() override;
+
+    AtomicFileWriter(const AtomicFileWriter&) = delete;
+    AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+
+    bool isOpen() const { return buffer.isOpen(); }
+
+    // Appends the first length bytes of sourcePath
+    bool copyFrom(const std::string& sourcePath, uint64_t length);
+
+    // Makes the new content durable and moves it into place
+    bool commit();
+
+private:
+    class Buffer : public std::streambuf {
+    public:
+        explicit Buffer(size_t size);
+        ~Buffer() override;
+
+        bool flush();
+
+#ifdef __linux__
+        bool isOpen() const { return fd >= 0; }
+
+        int fd = -1;
+#else
+        bool isOpen() const { return file.is_open(); }
+
+        std::ofstream file;
+#endif
+        bool failed = false;
+        uint64_t flushed = 0; // Bytes already written to fd
+
+    protected:
+        int_type overflow(int_type c) override;
+        int sync() override;
+        pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode mode) override;
+
+    private:
+        std::unique_ptr<char, void (*)(void*)> data;
+        size_t size;
+    };
+
+    Buffer buffer;
+    std::string path;
+    std::string tempPath;
+    bool committed;
+};
+
+// Overwrites path from offset on with tail, drops whatever followed and
+// fsyncs it. Unlike AtomicFileWriter this is not atomic; callers that must
+// survive a crash part way journal the tail first.
+bool replaceFileTail(const std::string& path, uint64_t offset, std::string_view tail);
+
+#endif // ATOMIC_FILE_WRITER_HPP
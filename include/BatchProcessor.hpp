@@ -0,0 +1,131 @@
+#ifndef BATCH_PROCESSOR_HPP
+#define BATCH_PROCESSOR_HPP
+
+#include "FileBatchReader.hpp"
+#include "FileHandlerCreator.hpp"
+#include "FileSniffer.hpp"
+#include "ProcessingOptions.hpp"
+#include "ResultCache.hpp"
+#include "TaskScheduler.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+// Size and modification time of a file
+struct FileVersion {
+    uint64_t size = 0;
+    std::filesystem::file_time_type modified;
+
+    bool operator==(const FileVersion& other) const = default;
+};
+
+// The version the file at path has now; false if it cannot be read
+bool currentVersion(const std::string& path, FileVersion& version);
+
+// Outcome of one file of a batch
+struct FileResult {
+    enum Status { Processed, Failed, Unsupported };
+
+    std::string path;
+    Status status = Failed;
+    std::string message; // Reason of a failure
+    std::string statistics; // Statistics written, as a JSON object
+    double seconds = 0;  // Wall time spent on the file
+    // The file right after its output was written, if it still had the size
+    // the handler left it with, so a watcher can tell its own writes from
+    // changes made since
+    std::optional<FileVersion> written;
+};
+
+// Handlers one worker is done with, one per creator type, handed out again
+// for the next file of that type so its rows, cells and value buffers keep
+// their capacity instead of being allocated and freed per file. Used by a
+// single worker, so it needs no lock.
+class HandlerPool {
+public:
+    // A reset spare handler of the creator's type, or a new one
+    std::unique_ptr<FileHandler> acquire(FileHandlerCreator& creator, const std::string& filePath);
+
+    // Keeps handler, made by creator, for the next acquire()
+    void release(const FileHandlerCreator& creator, std::unique_ptr<FileHandler> handler);
+
+private:
+    std::unordered_map<std::type_index, std::unique_ptr<FileHandler>> spares;
+};
+
+// Worker pool and read-ahead reader of a batch, kept across batches by the
+// watch mode so no thread or registered buffer is set up again per event,
+// the handler pools of the workers and the result cache, if any
+struct BatchResources {
+    TaskScheduler scheduler;
+    FileBatchReader reader;
+    std::vector<HandlerPool> handlers; // By worker index
+    std::unique_ptr<ResultCache> cache; // Skips files unchanged since they were processed
+
+    explicit BatchResources(unsigned workers) : scheduler(workers), handlers(scheduler.threadCount()) {}
+};
+
+// Extension of a path without the dot, or "" if it has none
+std::string getFileExtension(const std::string& filePath);
+
+// Makes the creator of the handlers of one file format
+using FileHandlerFactory = std::function<std::unique_ptr<FileHandlerCreator>(const ProcessingOptions& options)>;
+
+// Routes the format to factory instead of the built-in creator (CSV, JSON
+// and NDJSON are registered from the start). Not thread safe: register
+// before processing.
+void registerFileHandlerCreator(FileFormat format, FileHandlerFactory factory);
+
+// Factory for the handler of a file. The extension (csv and tsv, ndjson and
+// jsonl) decides; the sniffed contents decide for other names and between
+// JSON and NDJSON named .json, and a sniffed delimiter is passed on unless
+// options.delimiter is set. nullptr if the file type is not supported, the
+// file is compressed or its contents are of the other family than its
+// extension (JSON in a .csv file, say); reason, if given, then says which.
+std::unique_ptr<FileHandlerCreator> createFileHandlerCreator(const std::string& filePath, const ProcessingOptions& options,
+                                                             std::string* reason = nullptr);
+
+// Same, sniffing head, the file's contents (or their start) already read
+std::unique_ptr<FileHandlerCreator> createFileHandlerCreator(const std::string& filePath, std::string_view head, const ProcessingOptions& options,
+                                                             std::string* reason = nullptr);
+
+// Same on a sniff result
+std::unique_ptr<FileHandlerCreator> createFileHandlerCreator(const std::string& filePath, const SniffResult& sniffed, const ProcessingOptions& options,
+                                                             std::string* reason = nullptr);
+
+// Whether a file found in a directory or by a pattern is processed: a CSV,
+// TSV, JSON or NDJSON file that is not a side file written next to a data
+// file by earlier runs (e.g. data.csv.groups.csv)
+bool isBatchInput(const std::string& path);
+
+// Expands the inputs into a sorted, duplicate free list of files. Directories
+// are searched recursively for data files and glob patterns (*, ?,
+// [...]) are matched; files that are not isBatchInput() are skipped from
+// directories, side files from patterns. Plain paths are kept as given.
+std::vector<std::string> expandInputs(const std::vector<std::string>& inputs);
+
+// Reads, processes and writes every file through its FileHandlerCreator on a
+// work-stealing pool of options.threadCount() workers. Files up to
+// options.chunkSize bytes are one task each; larger files the handler can
+// split are parsed as chunk tasks that idle workers steal, then merged and
+// written by one more task. The threads of the parallel stages inside a
+// handler are split between the files. Results are in the order of files.
+std::vector<FileResult> processBatch(const std::vector<std::string>& files, const ProcessingOptions& options);
+
+// Same on the workers and reader of resources, which stay usable afterwards.
+// With a cache, files it reports unchanged are not processed again (message
+// "unchanged"), and the processed files are stored in it and saved.
+std::vector<FileResult> processBatch(const std::vector<std::string>& files, const ProcessingOptions& options, BatchResources& resources);
+
+// One line per file followed by a summary line
+void printBatchReport(std::ostream& out, const std::vector<FileResult>& results, double seconds, unsigned workers);
+
+#endif // BATCH_PROCESSOR_HPP
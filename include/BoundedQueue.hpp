@@ -0,0 +1,70 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Lock-free queue of fixed capacity between exactly one producer and one
+// consumer thread, used to connect the stages of a pipeline. A full queue
+// makes the producer wait, so a fast stage never runs more than capacity
+// items ahead of the next one. Waiting spins briefly, then yields.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity)
+        : slots(capacity + 1), head(0), tail(0), closed(false) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Producer side; waits while the queue is full
+    void push(T value) {
+        for (unsigned attempt = 0; !tryPush(value); ++attempt) backoff(attempt);
+    }
+
+    // Producer side; no item follows, the consumer drains what is queued
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+
+    // Consumer side; waits for an item, false once the queue is closed and empty
+    bool pop(T& value) {
+        for (unsigned attempt = 0; !tryPop(value); ++attempt) {
+            // Everything pushed before close() is visible once it is seen
+            if (closed.load(std::memory_order_acquire)) return tryPop(value);
+            backoff(attempt);
+        }
+        return true;
+    }
+
+    bool tryPush(T& value) {
+        size_t current = tail.load(std::memory_order_relaxed);
+        size_t next = current + 1 == slots.size() ? 0 : current + 1;
+        if (next == head.load(std::memory_order_acquire)) return false;
+        slots[current] = std::move(value);
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t current = head.load(std::memory_order_relaxed);
+        if (current == tail.load(std::memory_order_acquire)) return false;
+        value = std::move(slots[current]);
+        head.store(current + 1 == slots.size() ? 0 : current + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> slots; // One slot stays free to tell a full queue from an empty one
+    alignas(64) std::atomic<size_t> head; // Next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail; // Next slot to push, written by the producer
+    std::atomic<bool> closed;
+
+    static void backoff(unsigned attempt) {
+        if (attempt >= 64) std::this_thread::yield();
+    }
+};
+
+#endif // BOUNDED_QUEUE_HPP
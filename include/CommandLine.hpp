@@ -0,0 +1,15 @@
+#ifndef COMMAND_LINE_HPP
+#define COMMAND_LINE_HPP
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+
+// Parses a whole number no larger than limit. Unlike std::stoul it rejects a
+// sign, so "-5" is an error instead of wrapping around to a huge count.
+inline bool parseCount(const std::string& text, uint64_t limit, uint64_t& count) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), count);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size() && count <= limit;
+}
+
+#endif // COMMAND_LINE_HPP
@@ -0,0 +1,42 @@
+#ifndef COVARIANCE_MATRIX_HPP
+#define COVARIANCE_MATRIX_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Single-pass covariance accumulator over a fixed set of columns. Rows are
+// consumed in blocks: each block is centred on its own means into a small
+// column-major buffer, the pairwise co-moments are accumulated with
+// contiguous, vectorisable inner loops, and the block is folded into the
+// running totals with the pairwise (Chan et al.) update. The same update
+// merges accumulators built over separate row chunks.
+class CovarianceMatrix {
+public:
+    explicit CovarianceMatrix(size_t columns = 0);
+
+    // Adds rows [begin, end) of the given columns, one pointer per column
+    void addRows(const std::vector<const double*>& columns, size_t begin, size_t end);
+
+    void merge(const CovarianceMatrix& other);
+
+    size_t columnCount() const { return columns; }
+    size_t rowCount() const { return count; }
+    double mean(size_t column) const { return means[column]; }
+
+    // Population covariance / Pearson correlation (NaN for constant columns)
+    double covariance(size_t i, size_t j) const;
+    double correlation(size_t i, size_t j) const;
+
+private:
+    size_t columns;
+    size_t count;
+    std::vector<double> means;
+    std::vector<double> comoments; // Sum of (x_i - mean_i)(x_j - mean_j), row-major columns x columns
+
+    void mergeMoments(size_t otherCount, const std::vector<double>& otherMeans, const std::vector<double>& otherComoments);
+};
+
+// Covariance of equally long columns, accumulated over row chunks in parallel
+CovarianceMatrix calculateCovariance(const std::vector<std::vector<double>>& columns, unsigned threads);
+
+#endif // COVARIANCE_MATRIX_HPP
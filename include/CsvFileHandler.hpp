@@ -1,31 +1,184 @@
 #ifndef CSV_FILE_HANDLER_HPP
 #define CSV_FILE_HANDLER_HPP
 
+#include "CovarianceMatrix.hpp"
 #include "FileHandler.hpp"
+#include "GroupBy.hpp"
+#include "HyperLogLog.hpp"
+#include "OutputBuffer.hpp"
+#include "ProcessingOptions.hpp"
+#include "RollingStatistics.hpp"
+#include "SpaceSaving.hpp"
+#include "Statistics.hpp"
+#include "StatisticsState.hpp"
+#include "json.hpp"
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 // CsvFileHandler class inherits from FileHandler to handle CSV file operations
 class CsvFileHandler : public FileHandler {
 public:
-    // Constructor that initializes the file path
-    CsvFileHandler(const std::string& filePath);
+    // Constructor that initializes the file path and processing options
+    CsvFileHandler(const std::string& filePath, const ProcessingOptions& options = ProcessingOptions());
 
     // Override methods to read, write, and process CSV data
     void readData() override;
+    bool readContents(std::string contents) override;
+
+    // Parses the value column straight out of data when the options allow
+    // chunked parsing; otherwise splits the rows from it without a copy
+    bool readBuffer(std::string_view data) override;
+    bool readStream(std::istream& input) override;
     void writeData() override;
     void process() override;
+    bool succeeded() const override { return processed; }
+    std::string summary() const override;
+    const Statistics* valueStatistics() const override { return processed && !options.allColumns ? &stats : nullptr; }
+    std::optional<uint64_t> writtenSize() const override { return finalSize; }
+
+    // Chunked parsing of the value column for the batch scheduler. Only
+    // single-column statistics with percentiles, histogram and distinct ids
+    // are supported; the other options need every row at once.
+    size_t prepareChunks(uint64_t chunkSize) override;
+    void parseChunk(size_t index) override;
+    void mergeChunks() override;
+
+    // Keeps the rows' cell strings and the value buffer for the next file
+    bool reset(const std::string& filePath, const ProcessingOptions& options) override;
 
 private:
+    // Byte range of data rows parsed by one chunk task, and what it parsed
+    struct Chunk {
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        std::vector<double> values;
+        std::optional<HyperLogLog> ids;
+        std::string error; // Message of the first invalid row, if any
+    };
+
     std::string filePath; // Path to the CSV file
     std::vector<std::vector<std::string>> csvData; // Container for CSV data
-    double mean;
-    double median;
-    double std_dev;
+    std::vector<std::vector<std::string>> spareRows; // Rows of an earlier file, refilled by appendRow()
+    std::vector<double> values; // Values of the value column, kept across reset()
+    ProcessingOptions options;
+    char delimiter; // Cell separator of the data file
+    Statistics stats;
+    std::vector<ColumnStatistics> columnStats; // Per-column statistics in all-columns mode
+    std::vector<RollingValues> rolling; // Rolling window statistics for each data row
+    std::optional<HyperLogLog> idSketch; // Distinct-count sketch of the id column
+    std::optional<SpaceSaving> topIds;   // Heavy-hitter sketch of the id column
+    std::vector<std::string> correlationColumns; // Columns of the covariance matrix
+    std::optional<CovarianceMatrix> covariance;  // Covariance of the numeric columns
+    std::vector<std::pair<std::string, GroupStatistics>> groups; // Per-id aggregates in file order
+    uint64_t dataSize;                    // Size of the file when it was read
+    uint64_t dataEnd;                     // Offset of the recorded footer of an earlier run, or dataSize
+    std::optional<uint64_t> finalSize;    // Size of the file after writeData()
+    std::optional<StatisticsState> state; // Accumulators persisted between incremental runs
+    bool resumed;                         // Only the rows appended since the saved state were read
+    bool readFailed;                      // The file could not be opened
+    std::vector<Chunk> chunks;            // Pending chunks between prepareChunks() and mergeChunks()
+    size_t chunkedRows;                   // Data rows parsed by the chunk tasks
     bool hasInvalidData; // Flag to indicate presence of invalid data
+    bool processed;      // Statistics were computed
+
+    // Reads the rows in the first end bytes of file
+    void readRows(std::istream& file, uint64_t end);
+
+    // Splits line into a new last row of csvData, reusing a spare row
+    void appendRow(std::string_view line);
+
+    // Whether data rows were read, whole or in chunks
+    bool hasRows() const { return csvData.size() > 1 || chunkedRows > 0; }
+
+    // Parses the complete rows of text into the values and id sketch of chunk
+    void parseRows(std::string_view text, Chunk& chunk) const;
+
+    // Reads and parses the value column on a reader and a parser thread
+    // connected by bounded queues, while this thread aggregates the parsed
+    // batches into a single chunk for process(). Fails, leaving csvData
+    // untouched, when the options need every row.
+    bool readPipelined();
+
+    // Sets dataEnd to the start of the footer an earlier run wrote, if the
+    // file still ends with it, and to dataSize otherwise; contents, if given,
+    // are the whole file as read. A footer recorded in the state file must
+    // match byte for byte, one without a record by its labels.
+    void findFooter(std::optional<std::string_view> contents = std::nullopt);
+    void findUnrecordedFooter(std::optional<std::string_view> contents);
+
+    // Writes the data rows from firstRow on, with any derived columns
+    void writeRows(OutputBuffer& file, size_t firstRow) const;
+
+    // Loads the saved state and reads only the rows appended after it.
+    // Fails, leaving csvData untouched, if the state does not match the file.
+    bool resumeFromState();
+
+    // Rewrites the whole data file with the statistics footer appended
+    void rewriteData();
+
+    // The statistics as written to the sidecar file
+    nlohmann::json statisticsJson() const;
+
+    // Writes the statistics to the sidecar file, leaving the data file as is
+    void writeSidecar();
+
+    // Writes only the statistics footer at the end of the file, replacing
+    // the footer of an earlier run
+    void appendFooter();
+
+    // Replaces the previous footer by the appended rows and the new footer
+    void appendData();
+
+    // The state file once the data rows end at dataEnd and are followed by
+    // footer, so the next run can drop the footer: the incremental state, or
+    // a record of the footer alone. Empty if there is nothing to record.
+    std::string stateAfter(uint64_t dataEnd, std::string_view footer) const;
+
+    // Replaces the state file by text, or removes it if text is empty
+    void writeState(std::string_view text);
+
+    // Replaces the file from offset on by tail and the state file by
+    // stateText, crash-safely: both are journaled to "<file>.state.tail"
+    // first, and completeTail() finishes an interrupted replacement
+    void replaceTail(uint64_t offset, std::string_view tail, std::string_view stateText);
+    bool applyTail(uint64_t offset, std::string_view tail, std::string_view stateText);
+    void completeTail();
+
+    // Removes the state file, so the next run processes the whole file
+    void discardState() const;
+
+    // Merges the parsed values into the persisted state and derives the
+    // statistics of all rows processed so far
+    void processIncremental(const std::vector<double>& values);
+
+    // Computes statistics for every numeric column, one column per task
+    void processAllColumns();
+
+    // Writes the statistics rows, with each column's value under its header cell
+    void writeStatisticsFooter(OutputBuffer& file) const;
+
+    // Labels of the footer rows, in the order writeStatisticsFooter() writes them
+    std::vector<std::string> footerLabels() const;
+
+    // Computes the covariance matrix of the fully numeric columns
+    void processCorrelation();
+
+    // Writes the covariance and correlation matrices next to the data file
+    void writeCorrelation();
+
+    // Feeds an id into the id sketches that are enabled
+    void sketchId(std::string_view id);
+
+    // Writes the per-id aggregates next to the data file
+    void writeGroups();
 
-    // Method to calculate statistics (mean, median, std deviation)
-    void calculateStatistics(const std::vector<double>& values);
+    // Writes the rows flagged as outliers next to the data file
+    void writeOutliers();
 };
 
 #endif // CSV_FILE_HANDLER_HPP
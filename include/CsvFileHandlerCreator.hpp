@@ -7,9 +7,19 @@
 // Concrete factory class for creating CsvFileHandler objects
 class CsvFileHandlerCreator : public FileHandlerCreator {
 public: 
-    FileHandler* createFileHandler(const std::string &filePath) override {
-        return new CsvFileHandler(filePath);
+    CsvFileHandlerCreator(const ProcessingOptions &options = ProcessingOptions()) : options(options) {}
+
+    std::unique_ptr<FileHandler> createFileHandler(const std::string &filePath) override {
+        return std::make_unique<CsvFileHandler>(filePath, options);
+    }
+
+    std::unique_ptr<FileHandler> reuseFileHandler(std::unique_ptr<FileHandler> handler, const std::string &filePath) override {
+        if (handler && handler->reset(filePath, options)) return handler;
+        return createFileHandler(filePath);
     }
+
+private:
+    ProcessingOptions options; // Options passed to every created handler
 };
 
 
@@ -0,0 +1,81 @@
+#ifndef DATA_GENERATOR_HPP
+#define DATA_GENERATOR_HPP
+
+#include "FileSniffer.hpp"
+#include <cstdint>
+#include <string>
+
+// Distribution of the generated ids
+enum class IdDistribution {
+    Uniform, // Every id in [1, idCount] equally likely
+    Zipf     // Id k drawn with probability proportional to 1 / k^zipfExponent
+};
+
+// Distribution of the generated values
+enum class ValueDistribution {
+    Uniform, // In [minValue, maxValue)
+    Normal   // Around mean with standard deviation stdDev
+};
+
+// What generateDataFile() writes
+struct GeneratorOptions {
+    FileFormat format = FileFormat::Csv; // Csv, Json (an array in the dump(4) layout) or Ndjson
+    uint64_t rows = 1000000;
+    uint64_t seed = 1;
+    uint64_t chunkRows = 65536; // Rows per random stream; part of what the seed reproduces
+    IdDistribution ids = IdDistribution::Uniform;
+    uint64_t idCount = 10000;
+    double zipfExponent = 1.0;
+    ValueDistribution values = ValueDistribution::Uniform;
+    double minValue = 1.0;
+    double maxValue = 100.0;
+    double mean = 50.0;
+    double stdDev = 15.0;
+    double nanRate = 0.0; // Share of values written as NaN ("nan" in CSV, null in JSON)
+    double badRate = 0.0; // Share of values written as the non-numeric "n/a"
+    char delimiter = ',';
+    unsigned threads = 0; // 0 uses every hardware thread
+};
+
+// Samples ranks from a Zipf distribution over [1, count] in constant time
+// per draw with Hörmann and Derflinger's rejection-inversion method, so
+// millions of distinct ids need no table.
+class ZipfSampler {
+public:
+    ZipfSampler(uint64_t count, double exponent);
+
+    // Rank for a uniform draw source: next() returns doubles in [0, 1)
+    template <typename Uniform>
+    uint64_t operator()(Uniform& next) const {
+        while (true) {
+            double u = hIntegralCount + next() * (hIntegralFirst - hIntegralCount);
+            double x = hIntegralInverse(u);
+            uint64_t k = x < 1.5 ? 1 : static_cast<uint64_t>(x + 0.5);
+            if (k > count) k = count;
+            double rank = static_cast<double>(k);
+            if (rank - x <= squeeze || u >= hIntegral(rank + 0.5) - h(rank)) return k;
+        }
+    }
+
+private:
+    uint64_t count;
+    double exponent;
+    double hIntegralFirst;
+    double hIntegralCount;
+    double squeeze;
+
+    double h(double x) const;
+    double hIntegral(double x) const;
+    double hIntegralInverse(double x) const;
+};
+
+// Writes options.rows random id/value rows to path. The rows are generated
+// in chunks of options.chunkRows, in parallel, each from its own random
+// stream seeded with the seed and the chunk's index, and written in order,
+// so the file depends only on the options and not on the thread count. The
+// random numbers do not go through the <random> distributions, whose
+// output differs between standard libraries. False if the file could not
+// be written, with the reason in error if given.
+bool generateDataFile(const std::string& path, const GeneratorOptions& options, std::string* error = nullptr);
+
+#endif // DATA_GENERATOR_HPP
@@ -0,0 +1,42 @@
+#ifndef DATA_PROCESSOR_CORE_HPP
+#define DATA_PROCESSOR_CORE_HPP
+
+#include "FileSniffer.hpp"
+#include "ProcessingOptions.hpp"
+#include "Statistics.hpp"
+#include <istream>
+#include <optional>
+#include <span>
+#include <string>
+
+// In-process entry points of the dataprocessor_core library, for callers
+// that hold the data in memory (e.g. a network buffer) instead of a file.
+// The data goes through the same handlers as a file of the same format but
+// nothing is written: no data file, sidecar or side file, so options that
+// only produce side files (group-by, outliers, correlation, rolling
+// columns) have no visible effect, and incremental and pipelined reading,
+// which need a file, are ignored.
+
+// Statistics of one in-memory document
+struct StatisticsResult {
+    bool succeeded = false;       // Statistics were computed
+    std::string error;            // Why not, if they were not
+    FileFormat format = FileFormat::Unknown; // Format the data was read as
+    std::optional<Statistics> values; // Statistics of the value column, unless all columns were processed
+    std::string json;             // The statistics as written to a .stats.json sidecar
+};
+
+// Processes CSV, JSON or NDJSON data, told apart by sniffing its start. The
+// CSV value column, JSON documents and NDJSON lines are parsed straight out
+// of data, without copying it; data only needs to live until the call
+// returns.
+StatisticsResult processBuffer(std::span<const char> data, const ProcessingOptions& options = ProcessingOptions());
+
+// Same, reading input to its end. The format cannot be sniffed without
+// consuming the stream: with FileFormat::Unknown the stream is read into
+// memory first and sniffed, otherwise it is parsed as it is read (CSV rows
+// are split with options.delimiter, ',' if it is 0).
+StatisticsResult processStream(std::istream& input, FileFormat format = FileFormat::Unknown,
+                               const ProcessingOptions& options = ProcessingOptions());
+
+#endif // DATA_PROCESSOR_CORE_HPP
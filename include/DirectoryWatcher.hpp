@@ -0,0 +1,80 @@
+#ifndef DIRECTORY_WATCHER_HPP
+#define DIRECTORY_WATCHER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <unordered_map>
+#else
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <utility>
+#endif
+
+// Reports the input files that changed, using inotify. Directories are
+// watched recursively, including directories created later; plain paths and
+// glob patterns are matched in the directories that contain them. Only
+// files accepted by isBatchInput() are reported. When the kernel's event
+// queue overflows, every input file is reported, since any of them may have
+// changed unseen. Other systems poll: the inputs are expanded once a second
+// and files whose size or modification time changed are reported.
+class DirectoryWatcher {
+public:
+    explicit DirectoryWatcher(const std::vector<std::string>& inputs);
+    ~DirectoryWatcher();
+
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+#ifdef __linux__
+    // Whether inotify could be set up and at least one directory is watched
+    bool isOpen() const { return fd >= 0 && !directories.empty(); }
+#else
+    bool isOpen() const { return !inputs.empty(); }
+#endif
+
+    // Blocks until a file changed, then collects events until none arrived
+    // for debounce, so a file written in many steps is reported once.
+    // Returns the changed files, sorted; empty once stop is set.
+    std::vector<std::string> wait(std::chrono::milliseconds debounce, const std::atomic<bool>& stop);
+
+    // What could not be watched since the last call; the watcher never
+    // prints, the caller reports it
+    std::vector<std::string> takeErrors() { return std::exchange(errors, {}); }
+
+private:
+    std::vector<std::string> inputs;
+    std::vector<std::string> errors;
+
+#ifdef __linux__
+    struct Watch {
+        std::string directory; // "" for the working directory
+        bool recursive = false; // Every input file below it is reported
+    };
+
+    int fd;
+    std::unordered_map<int, Watch> directories; // By watch descriptor
+    std::vector<std::string> patterns;          // Paths and glob patterns of single inputs
+
+    void watch(const std::string& directory, bool recursive);
+
+    // Reads the pending events into changed; false if there were none
+    bool readEvents(std::vector<std::string>& changed);
+
+    bool accepts(const std::string& path, bool recursive) const;
+#else
+    // Modification time and size of every input file at the last scan
+    std::map<std::string, std::pair<std::filesystem::file_time_type, uintmax_t>> snapshot;
+
+    // Expands the inputs and adds the files that differ from the snapshot
+    // to changed; false if none did
+    bool scan(std::vector<std::string>& changed);
+#endif
+};
+
+#endif // DIRECTORY_WATCHER_HPP
@@ -0,0 +1,43 @@
+#ifndef FILE_BATCH_READER_HPP
+#define FILE_BATCH_READER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Reads many whole files with up to depth of them in flight. On Linux the
+// opens, reads and closes are queued on an io_uring, reading into buffers
+// registered with the kernel once, so a batch of small files costs a few
+// io_uring_enter calls instead of three blocking syscalls per file. Where
+// io_uring is unavailable (old kernel, seccomp filter) the files are read
+// one after the other with open/pread/close, and on other systems with
+// std::ifstream.
+class FileBatchReader {
+public:
+    // Called on the reading thread for every file, in completion order, with
+    // its contents or the errno of the failed open or read
+    using Callback = std::function<void(size_t index, std::string&& data, int error)>;
+
+    // ioUring false always uses the pread fallback
+    explicit FileBatchReader(unsigned depth = 64, bool ioUring = true);
+    ~FileBatchReader();
+
+    FileBatchReader(const FileBatchReader&) = delete;
+    FileBatchReader& operator=(const FileBatchReader&) = delete;
+
+    // Whether the io_uring could be set up
+    bool usesIoUring() const { return ring != nullptr; }
+
+    void readAll(const std::vector<std::string>& paths, const Callback& onFile);
+
+private:
+    struct Ring;
+    std::unique_ptr<Ring> ring;
+    unsigned depth;
+
+    void readWithPread(const std::vector<std::string>& paths, const Callback& onFile);
+};
+
+#endif // FILE_BATCH_READER_HPP
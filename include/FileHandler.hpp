@@ -1,7 +1,15 @@
 #ifndef FILE_HANDLER_HPP
 #define FILE_HANDLER_HPP
 
+#include "ProcessingOptions.hpp"
+#include "Statistics.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <optional>
 #include <string>
+#include <string_view>
 
 // Abstract base class for file handlers
 class FileHandler {
@@ -12,8 +20,67 @@ public:
     virtual void writeData() = 0;
     virtual void process() = 0; 
 
+    // Takes the contents of the file, already read by the caller, in place
+    // of readData(); false if the handler has to read the file itself
+    virtual bool readContents(std::string) { return false; }
+
+    // Same from a buffer the caller owns; nothing refers to data afterwards.
+    // Handlers that parse it in place override this to avoid the copy.
+    virtual bool readBuffer(std::string_view data) { return readContents(std::string(data)); }
+
+    // Same from a stream positioned at the start of the contents
+    virtual bool readStream(std::istream& input) {
+        return readContents(std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()));
+    }
+
+    // Whether process() computed statistics to write. Handlers that cannot
+    // tell report success.
+    virtual bool succeeded() const { return true; }
+
+    // Statistics computed by process() as a JSON object, "" if there are none
+    virtual std::string summary() const { return ""; }
+
+    // Statistics of the value column computed by process(); nullptr if there
+    // are none or every column was processed (see summary())
+    virtual const Statistics* valueStatistics() const { return nullptr; }
+
+    // Size writeData() left the data file with: as read if it was not
+    // changed, as written otherwise; nullopt if unknown or the write failed.
+    // A batch only caches the result of a file that still has this size.
+    virtual std::optional<uint64_t> writtenSize() const { return std::nullopt; }
+
+    // Optional chunked processing used by the batch scheduler in place of
+    // readData() and process(). prepareChunks() splits the rows into byte
+    // ranges of about chunkSize bytes and returns their number, 0 if the
+    // handler or its options need the whole file at once. parseChunk() may
+    // run concurrently for different chunks; mergeChunks() runs after all of
+    // them and leaves the handler ready for writeData().
+    virtual size_t prepareChunks(uint64_t) { return 0; }
+    virtual void parseChunk(size_t) {}
+    virtual void mergeChunks() {}
+
+    // Rebinds the handler to another file, leaving it as if newly constructed
+    // with these options but keeping the capacity of its buffers, so a batch
+    // reuses one handler for many files; false if the handler cannot be reset
+    virtual bool reset(const std::string&, const ProcessingOptions&) { return false; }
+
+    // What went wrong, "" if nothing did: the first error the handler hit,
+    // since later ones mostly follow from it. Handlers never print; the
+    // caller reports it. Also set when the statistics were computed but a
+    // file could not be written.
+    const std::string& errorMessage() const { return error; }
+
     // Virtual destructor
     virtual ~FileHandler() = default;
+
+protected:
+    // Records message, unless an earlier error was recorded
+    void setError(const std::string& message) {
+        if (error.empty()) error = message;
+    }
+
+private:
+    std::string error;
 };
 
 #endif // fILe_HANDLER_HPP
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define FILE_HANDLER_CREATOR_HPP
 
 #include "FileHandler.hpp"
+#include <memory>
 #include <string>
 
 // Abstract factory class for creating FileHandler objects
@@ -10,7 +11,13 @@ public:
     virtual ~FileHandlerCreator() = default;
 
     // Pure virtual method to create a FileHandler
-    virtual FileHandler* createFileHandler(const std::string &filePath) = 0; 
+    virtual std::unique_ptr<FileHandler> createFileHandler(const std::string &filePath) = 0;
+
+    // Handler for filePath made by resetting handler, which a creator of the
+    // same type made and is done with, or a new one if it cannot be reset
+    virtual std::unique_ptr<FileHandler> reuseFileHandler(std::unique_ptr<FileHandler>, const std::string &filePath) {
+        return createFileHandler(filePath);
+    }
 };
 
 #endif // FILE_HANDLER_CREATOR_HPP
\ No newline at end of file
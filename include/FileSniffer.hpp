@@ -0,0 +1,35 @@
+#ifndef FILE_SNIFFER_HPP
+#define FILE_SNIFFER_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Data formats told apart by their contents
+enum class FileFormat {
+    Unknown,    // Not recognised; the file extension decides
+    Csv,        // Delimited text
+    Json,       // A JSON array of entries
+    Ndjson,     // One JSON object per line
+    Compressed  // gzip, bzip2, xz, zstd or zip; not supported
+};
+
+// What the first bytes of a file look like
+struct SniffResult {
+    FileFormat format = FileFormat::Unknown;
+    char delimiter = ',';     // Cell separator of Csv: ',', '\t', ';' or '|'
+    std::string compression;  // Name of the compression of Compressed
+};
+
+// Bytes of a file that are inspected
+const size_t sniffLength = 4096;
+
+// Inspects the start of a file: compression magic bytes, a leading '[' or
+// one object per line for JSON, and the separator that splits the first
+// lines into the same number of cells for CSV
+SniffResult sniffContents(std::string_view head);
+
+// Same on the first sniffLength bytes of the file
+SniffResult sniffFile(const std::string& filePath);
+
+#endif // FILE_SNIFFER_HPP
@@ -0,0 +1,136 @@
+#ifndef FLAT_HASH_MAP_HPP
+#define FLAT_HASH_MAP_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Open-addressing hash map with linear probing. Keys and values live inline
+// in one contiguous slot array, and a parallel array of one byte control tags
+// (7 bits of the hash, 0 for an empty slot) lets a probe skip most slots
+// without touching their keys. Erasing uses backward-shift deletion, so no
+// tombstones accumulate; clear() keeps the allocated capacity for reuse.
+//
+// Hash must accept every lookup key type, which allows heterogeneous lookups
+// such as std::string keys probed with std::string_view.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class FlatHashMap {
+public:
+    explicit FlatHashMap(size_t expectedSize = 0) : count(0) {
+        size_t capacity = 16;
+        while (capacity * 3 < expectedSize * 4) capacity *= 2;
+        tags.assign(capacity, 0);
+        slots.resize(capacity);
+    }
+
+    // Returns the value stored for key, inserting a default one if missing
+    template <typename K>
+    Value& operator[](const K& key) {
+        if ((count + 1) * 4 > slots.size() * 3) grow();
+
+        size_t hash = Hash()(key);
+        uint8_t tag = tagOf(hash);
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            if (tags[i] == 0) {
+                tags[i] = tag;
+                slots[i].first = Key(key);
+                ++count;
+                return slots[i].second;
+            }
+            if (tags[i] == tag && slots[i].first == key) {
+                return slots[i].second;
+            }
+        }
+    }
+
+    // Returns the value stored for key, or nullptr if there is none
+    template <typename K>
+    const Value* find(const K& key) const {
+        size_t hash = Hash()(key);
+        uint8_t tag = tagOf(hash);
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask; tags[i] != 0; i = (i + 1) & mask) {
+            if (tags[i] == tag && slots[i].first == key) {
+                return &slots[i].second;
+            }
+        }
+        return nullptr;
+    }
+
+    // Removes key if present; returns whether an element was erased
+    template <typename K>
+    bool erase(const K& key) {
+        size_t mask = slots.size() - 1;
+        size_t hash = Hash()(key);
+        uint8_t tag = tagOf(hash);
+        size_t hole = hash & mask;
+        for (;; hole = (hole + 1) & mask) {
+            if (tags[hole] == 0) return false;
+            if (tags[hole] == tag && slots[hole].first == key) break;
+        }
+
+        // Shift back later elements of the cluster whose home slot does not
+        // lie cyclically in (hole, i], so every element stays reachable
+        for (size_t i = (hole + 1) & mask; tags[i] != 0; i = (i + 1) & mask) {
+            size_t home = Hash()(slots[i].first) & mask;
+            bool stays = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+            if (stays) continue;
+            tags[hole] = tags[i];
+            slots[hole] = std::move(slots[i]);
+            hole = i;
+        }
+        tags[hole] = 0;
+        slots[hole] = std::pair<Key, Value>();
+        --count;
+        return true;
+    }
+
+    // Calls f(key, value) for every element, in unspecified order
+    template <typename F>
+    void forEach(F f) const {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (tags[i] != 0) f(slots[i].first, slots[i].second);
+        }
+    }
+
+    size_t size() const { return count; }
+
+    void clear() {
+        std::fill(tags.begin(), tags.end(), 0);
+        for (auto& slot : slots) slot = std::pair<Key, Value>();
+        count = 0;
+    }
+
+private:
+    std::vector<uint8_t> tags;
+    std::vector<std::pair<Key, Value>> slots;
+    size_t count;
+
+    static uint8_t tagOf(size_t hash) {
+        // Top 7 bits of the hash with the high bit set, so a tag is never 0
+        return static_cast<uint8_t>((hash >> (sizeof(size_t) * 8 - 7)) | 0x80);
+    }
+
+    void grow() {
+        std::vector<uint8_t> oldTags(slots.size() * 2, 0);
+        std::vector<std::pair<Key, Value>> oldSlots(slots.size() * 2);
+        oldTags.swap(tags);
+        oldSlots.swap(slots);
+
+        size_t mask = slots.size() - 1;
+        for (size_t j = 0; j < oldSlots.size(); ++j) {
+            if (oldTags[j] == 0) continue;
+            size_t hash = Hash()(oldSlots[j].first);
+            size_t i = hash & mask;
+            while (tags[i] != 0) i = (i + 1) & mask;
+            tags[i] = tagOf(hash);
+            slots[i] = std::move(oldSlots[j]);
+        }
+    }
+};
+
+#endif // FLAT_HASH_MAP_HPP
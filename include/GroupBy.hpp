@@ -0,0 +1,35 @@
+#ifndef GROUP_BY_HPP
+#define GROUP_BY_HPP
+
+#include "FlatHashMap.hpp"
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Per-id aggregate produced by the group-by mode
+struct GroupStatistics {
+    size_t firstRow = 0; // Row of the first occurrence, keeps the output in file order
+    size_t count = 0;
+    double sum = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+
+    void add(double value, size_t row);
+    void merge(const GroupStatistics& other);
+    double mean() const { return count ? sum / count : 0.0; }
+};
+
+using GroupTable = FlatHashMap<std::string, GroupStatistics, std::hash<std::string_view>>;
+
+// Aggregates values[i] under ids[i]. The rows are split into contiguous
+// slices which worker threads pre-aggregate into private tables; the private
+// tables are merged once all workers are done.
+GroupTable aggregateGroups(const std::vector<std::string_view>& ids, const std::vector<double>& values, unsigned threads);
+
+// Groups of a table, ordered by their first appearance in the file
+std::vector<std::pair<std::string, GroupStatistics>> sortedGroups(const GroupTable& table);
+
+#endif // GROUP_BY_HPP
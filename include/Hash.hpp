@@ -0,0 +1,62 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Full 128-bit product of a and b: returns the low half, stores the high
+// half. Uses the compiler's 128-bit integers where they exist
+inline uint64_t multiply128(uint64_t a, uint64_t b, uint64_t& high) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    high = static_cast<uint64_t>(product >> 64);
+    return static_cast<uint64_t>(product);
+#else
+    uint64_t aLow = a & 0xFFFFFFFFULL, aHigh = a >> 32;
+    uint64_t bLow = b & 0xFFFFFFFFULL, bHigh = b >> 32;
+    uint64_t lowLow = aLow * bLow;
+    uint64_t highLow = aHigh * bLow;
+    uint64_t lowHigh = aLow * bHigh;
+    uint64_t cross = (lowLow >> 32) + (highLow & 0xFFFFFFFFULL) + lowHigh;
+    high = aHigh * bHigh + (highLow >> 32) + (cross >> 32);
+    return (cross << 32) | (lowLow & 0xFFFFFFFFULL);
+#endif
+}
+
+// 64-bit non-cryptographic hash of a byte range (the XXH64 algorithm)
+uint64_t hash64(const void* data, size_t length, uint64_t seed = 0);
+
+inline uint64_t hash64(std::string_view text, uint64_t seed = 0) {
+    return hash64(text.data(), text.size(), seed);
+}
+
+// Streaming 64-bit hash for whole files, built like XXH3's long-input loop:
+// eight 64-bit lanes take a 64 byte stripe per step with one 32x32->64
+// multiply each, which SSE2 does two lanes per instruction, and are
+// scrambled every 1 KiB. Much faster than hash64 on large inputs, but its
+// values differ from XXH3's (own keys, XXH64 for the tail).
+class ContentHasher {
+public:
+    ContentHasher();
+
+    void update(const void* data, size_t length);
+
+    // Hash of everything passed to update() so far
+    uint64_t digest() const;
+
+private:
+    alignas(16) uint64_t lanes[8];
+    unsigned char pending[64]; // Bytes of an incomplete stripe
+    size_t pendingSize;
+    size_t stripes;            // Stripes since the last scramble
+    uint64_t length;
+
+    void consume(const unsigned char* data, size_t count);
+};
+
+// Hashes the contents of a file with ContentHasher; false if it cannot be read
+bool hashFile(const std::string& path, uint64_t& hash);
+
+#endif // HASH_HPP
@@ -0,0 +1,64 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include "FlatHashMap.hpp"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Log-linear histogram in the spirit of HdrHistogram. Every power of two is
+// split into equally sized sub-buckets, enough of them to keep the relative
+// error of a recorded value below 10^-significantDigits. Histograms with the
+// same precision can be merged, so partial histograms built over chunks or
+// files combine into the histogram of the whole data set.
+//
+// Only buckets that were hit are stored, so memory follows the number of
+// distinct buckets recorded, not the range of the values: at 5 digits a
+// power of two alone has 131072 sub-buckets.
+class Histogram {
+public:
+    // significantDigits is clamped to the range [1, 5]
+    explicit Histogram(int significantDigits = 2);
+
+    // Records a value; NaN and infinite values are ignored
+    void record(double value, uint64_t count = 1);
+
+    // Adds the counts of another histogram. Fails if the precisions differ.
+    bool merge(const Histogram& other);
+
+    uint64_t totalCount() const;
+    int getSignificantDigits() const { return significantDigits; }
+
+    // Approximate value at the given percentile (0-100), within the precision
+    double valueAtPercentile(double percentile) const;
+
+    // Compact text form "digits;zeros;positive;negative" where each bucket
+    // list holds '/' separated "index:count" pairs with delta encoded indices
+    std::string serialize() const;
+    static bool deserialize(const std::string& text, Histogram& histogram);
+
+private:
+    // Mixes the bits of a bucket index, so neighbouring buckets spread over
+    // the table and the top bits used as probe tags vary
+    struct IndexHash {
+        size_t operator()(int64_t index) const;
+    };
+
+    // Counts of the buckets that were hit, keyed by bucket index
+    using Buckets = FlatHashMap<int64_t, uint64_t, IndexHash>;
+
+    int significantDigits;
+    int subBucketBits; // log2 of the number of sub-buckets per power of two
+    uint64_t zeroCount;
+    Buckets positive; // Buckets for values > 0
+    Buckets negative; // Buckets for the magnitude of values < 0
+
+    int64_t bucketIndex(double magnitude) const;
+    double bucketValue(int64_t index) const;
+
+    // The (index, count) pairs of buckets in increasing index order
+    static std::vector<std::pair<int64_t, uint64_t>> sorted(const Buckets& buckets);
+};
+
+#endif // HISTOGRAM_HPP
@@ -0,0 +1,39 @@
+#ifndef HYPER_LOG_LOG_HPP
+#define HYPER_LOG_LOG_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// HyperLogLog distinct-count sketch. 2^precision one byte registers keep the
+// longest run of leading zero bits seen among the hashes routed to them,
+// giving a relative error of about 1.04 / sqrt(2^precision) in constant
+// memory. Sketches of equal precision merge by taking the register maximum,
+// so counts can be combined across chunks, threads and files.
+class HyperLogLog {
+public:
+    // precision is clamped to the range [4, 18]
+    explicit HyperLogLog(int precision = 12);
+
+    void addHash(uint64_t hash);
+    void add(std::string_view key);
+
+    // Takes the register-wise maximum. Fails if the precisions differ.
+    bool merge(const HyperLogLog& other);
+
+    // Estimated number of distinct keys added
+    uint64_t estimate() const;
+
+    int getPrecision() const { return precision; }
+
+    // Text form "precision;registers" with every register as two hex digits
+    std::string serialize() const;
+    static bool deserialize(const std::string& text, HyperLogLog& sketch);
+
+private:
+    int precision;
+    std::vector<uint8_t> registers;
+};
+
+#endif // HYPER_LOG_LOG_HPP
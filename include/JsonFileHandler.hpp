@@ -1,32 +1,82 @@
 #ifndef JSON_FILE_HANDLER_HPP
 #define JSON_FILE_HANDLER_HPP
 
+#include "CovarianceMatrix.hpp"
 #include "FileHandler.hpp"
+#include "GroupBy.hpp"
+#include "HyperLogLog.hpp"
+#include "SpaceSaving.hpp"
+#include "ProcessingOptions.hpp"
+#include "Statistics.hpp"
 #include "json.hpp"
+#include <optional>
+#include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 // JsonFileHandler class inherits from FileHandler to handle JSON file operations
 class JsonFileHandler : public FileHandler {
 public:
-    // Constructor that initializes the file path
-    JsonFileHandler(const std::string& filePath);
+    // Constructor that initializes the file path and processing options
+    JsonFileHandler(const std::string& filePath, const ProcessingOptions& options = ProcessingOptions());
 
     // Override methods to read, write, and process JSON data
     void readData() override;
+    bool readContents(std::string contents) override;
+    bool readBuffer(std::string_view data) override;
+    bool readStream(std::istream& input) override;
     void writeData() override;
     void process() override;
+    bool succeeded() const override { return processed; }
+    std::string summary() const override { return statsEntry.is_null() ? "" : statsEntry.dump(); }
+    const Statistics* valueStatistics() const override { return processed && !options.allColumns ? &stats : nullptr; }
+    std::optional<uint64_t> writtenSize() const override { return finalSize; }
 
-private:
+    // Keeps the capacity of the entry array; the entries themselves are
+    // rebuilt by the parser
+    bool reset(const std::string& filePath, const ProcessingOptions& options) override;
+
+protected:
     std::string filePath; // Path to the JSON file
-    nlohmann::json jsonData; // Container for JSON data
-    double mean;
-    double median;
-    double std_dev;
+    nlohmann::json jsonData; // Container for JSON data, an array of entries
+    ProcessingOptions options;
+    bool parseFailed; // The data could not be parsed, so the file is never rewritten
+    std::optional<uint64_t> readSize; // Size of the file when reading started, if known
+
+    // Writes the entries, with the statistics entry last, as the rewritten file
+    virtual void writeDocument(std::ostream& file) const;
+
+private:
+    Statistics stats;
+    nlohmann::json statsEntry; // Statistics entry to write, null if none was computed
+    std::optional<uint64_t> finalSize; // Size of the file after writeData()
+    std::vector<ColumnStatistics> columnStats; // Per-key statistics in all-columns mode
+    std::optional<HyperLogLog> idSketch; // Distinct-count sketch of the "id" key
+    std::optional<SpaceSaving> topIds;   // Heavy-hitter sketch of the "id" key
+    std::vector<std::string> correlationColumns; // Keys of the covariance matrix
+    std::optional<CovarianceMatrix> covariance;  // Covariance of the numeric keys
+    std::vector<std::pair<std::string, GroupStatistics>> groups; // Per-id aggregates in file order
     bool hasInvalidData; // Flag to indicate presence of invalid data
+    bool processed;      // Statistics were computed
+
+    // Computes statistics for every numeric key, one key per task
+    void processAllColumns();
+
+    // Computes the covariance matrix of the keys that are numeric in every entry
+    void processCorrelation();
+
+    // Writes the covariance and correlation matrices next to the data file
+    void writeCorrelation();
+
+    // Feeds an id into the id sketches that are enabled
+    void sketchId(std::string_view id);
+
+    // Writes the per-id aggregates next to the data file
+    void writeGroups();
 
-    // Method to calculate statistics (mean, median, std deviation)
-    void calculateStatistics(const std::vector<double>& values);
+    // Writes the entries flagged as outliers next to the data file
+    void writeOutliers();
 };
 
 #endif // JSON_FILE_HANDLER_HPP
@@ -7,10 +7,20 @@
 // Concrete factory class for creating JsonFileHandler objects
 class JsonFileHandlerCreator : public FileHandlerCreator {
 public: 
+    JsonFileHandlerCreator(const ProcessingOptions &options = ProcessingOptions()) : options(options) {}
+
     // Override method to create a JsonFileHandler
-    FileHandler *createFileHandler(const std::string &filePath) override {
-        return new JsonFileHandler(filePath);
+    std::unique_ptr<FileHandler> createFileHandler(const std::string &filePath) override {
+        return std::make_unique<JsonFileHandler>(filePath, options);
+    }
+
+    std::unique_ptr<FileHandler> reuseFileHandler(std::unique_ptr<FileHandler> handler, const std::string &filePath) override {
+        if (handler && handler->reset(filePath, options)) return handler;
+        return createFileHandler(filePath);
     }
+
+private:
+    ProcessingOptions options; // Options passed to every created handler
 };
 
 #endif // FILE_HANDLER_CREATOR_HPP
\ No newline at end of file
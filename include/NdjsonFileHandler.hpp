@@ -0,0 +1,29 @@
+#ifndef NDJSON_FILE_HANDLER_HPP
+#define NDJSON_FILE_HANDLER_HPP
+
+#include "JsonFileHandler.hpp"
+
+// NdjsonFileHandler handles newline-delimited JSON: one entry per line,
+// parsed line by line into the entry array JsonFileHandler processes, and
+// written back one line per entry, the statistics entry last
+class NdjsonFileHandler : public JsonFileHandler {
+public:
+    NdjsonFileHandler(const std::string& filePath, const ProcessingOptions& options = ProcessingOptions());
+
+    void readData() override;
+    bool readContents(std::string contents) override;
+    bool readBuffer(std::string_view data) override;
+    bool readStream(std::istream& input) override;
+
+protected:
+    void writeDocument(std::ostream& file) const override;
+
+private:
+    // Empties the entry array before a read
+    void clearEntries();
+
+    // Parses one line into an entry; blank lines are skipped
+    bool parseLine(std::string_view line, size_t lineNumber);
+};
+
+#endif // NDJSON_FILE_HANDLER_HPP
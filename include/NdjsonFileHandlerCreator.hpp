@@ -0,0 +1,25 @@
+#ifndef NDJSON_FILE_HANDLER_CREATOR_HPP
+#define NDJSON_FILE_HANDLER_CREATOR_HPP
+
+#include "FileHandlerCreator.hpp"
+#include "NdjsonFileHandler.hpp"
+
+// Concrete factory class for creating NdjsonFileHandler objects
+class NdjsonFileHandlerCreator : public FileHandlerCreator {
+public:
+    NdjsonFileHandlerCreator(const ProcessingOptions &options = ProcessingOptions()) : options(options) {}
+
+    std::unique_ptr<FileHandler> createFileHandler(const std::string &filePath) override {
+        return std::make_unique<NdjsonFileHandler>(filePath, options);
+    }
+
+    std::unique_ptr<FileHandler> reuseFileHandler(std::unique_ptr<FileHandler> handler, const std::string &filePath) override {
+        if (handler && handler->reset(filePath, options)) return handler;
+        return createFileHandler(filePath);
+    }
+
+private:
+    ProcessingOptions options; // Options passed to every created handler
+};
+
+#endif // NDJSON_FILE_HANDLER_CREATOR_HPP
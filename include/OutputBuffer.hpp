@@ -0,0 +1,63 @@
+#ifndef OUTPUT_BUFFER_HPP
+#define OUTPUT_BUFFER_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Append-only text buffer for the output files. Cells are copied in with
+// memcpy, and numbers are formatted with std::to_chars: integers directly,
+// doubles in the shortest form that reads back to the same value, without
+// locale lookups or a virtual stream call per cell. The text is handed to
+// the sink in large blocks; without a sink it is kept for view().
+class OutputBuffer {
+public:
+    // Buffers in memory only
+    OutputBuffer() : sink(nullptr), capacity(0) {}
+
+    // Writes to sink whenever capacity bytes have been buffered
+    explicit OutputBuffer(std::ostream& sink, size_t capacity = size_t(1) << 16);
+
+    // Flushes to the sink, if any
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    OutputBuffer& operator<<(std::string_view text) {
+        buffer.append(text.data(), text.size());
+        if (sink && buffer.size() >= capacity) flush();
+        return *this;
+    }
+
+    OutputBuffer& operator<<(char c) {
+        buffer.push_back(c);
+        if (sink && buffer.size() >= capacity) flush();
+        return *this;
+    }
+
+    OutputBuffer& operator<<(double value);
+
+    template <typename Integer, typename = std::enable_if_t<std::is_integral_v<Integer> && !std::is_same_v<Integer, char> && !std::is_same_v<Integer, bool>>>
+    OutputBuffer& operator<<(Integer value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        return *this << std::string_view(digits, static_cast<size_t>(result.ptr - digits));
+    }
+
+    // Hands the buffered text to the sink
+    void flush();
+
+    // Buffered text not yet flushed
+    std::string_view view() const { return buffer; }
+
+private:
+    std::ostream* sink;
+    size_t capacity;
+    std::string buffer;
+};
+
+#endif // OUTPUT_BUFFER_HPP
@@ -0,0 +1,36 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Runs task(i) for every i in [0, count) on up to threads threads, the
+// calling thread included. Workers claim indices from a shared counter, so
+// tasks of uneven cost still keep every worker busy.
+template <typename Task>
+void parallelFor(size_t count, unsigned threads, Task task) {
+    size_t workers = std::min<size_t>(count, threads);
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; ++i) task(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) task(i);
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t w = 1; w < workers; ++w) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+#endif // PARALLEL_HPP
@@ -0,0 +1,21 @@
+#ifndef PATH_PATTERN_HPP
+#define PATH_PATTERN_HPP
+
+#include <string>
+#include <vector>
+
+// Shell wildcard patterns (*, ? and [...]) on paths, as glob(3) and
+// fnmatch(3) with FNM_PATHNAME expand and match them: wildcards never
+// match a '/', and names starting with '.' only match a pattern that
+// starts with '.' as well. Uses the C library on Linux and directory
+// iteration elsewhere.
+
+bool hasWildcards(const std::string& path);
+
+// Whether path matches pattern as a whole
+bool matchesPattern(const std::string& pattern, const std::string& path);
+
+// Existing paths matching pattern, sorted; only directories if onlyDirectories
+std::vector<std::string> expandPattern(const std::string& pattern, bool onlyDirectories = false);
+
+#endif // PATH_PATTERN_HPP
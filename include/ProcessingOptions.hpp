@@ -0,0 +1,66 @@
+#ifndef PROCESSING_OPTIONS_HPP
+#define PROCESSING_OPTIONS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Bit flags selecting the statistics to compute
+enum StatisticFlags : unsigned {
+    StatMean = 1,
+    StatMedian = 2,
+    StatStdDev = 4,
+    StatPercentiles = 8, // Implied by a non-empty percentile list
+    StatRobust = 16,     // MAD and outlier counts, implied by ProcessingOptions::robust
+    StatDefault = StatMean | StatMedian | StatStdDev
+};
+
+// Where the handlers write the statistics
+enum class OutputMode {
+    Rewrite, // Rewrite the data file with the statistics appended
+    Append,  // Append the statistics to the data file in place (CSV)
+    Sidecar  // Write "<file>.stats.json" and leave the data file untouched
+};
+
+// Options controlling which statistics the file handlers compute and write
+struct ProcessingOptions {
+    unsigned statistics = StatDefault; // StatisticFlags of the statistics to write
+    std::vector<double> percentiles; // Extra percentiles (0-100) written next to mean/median/std_dev
+    int histogramDigits = 0;         // Significant digits of the value histogram, 0 disables it
+    bool robust = false;             // Write the median absolute deviation and outlier counts
+    bool writeOutliers = false;      // Write the rows flagged as outliers to a separate file (implies robust)
+    double zScoreThreshold = 3.0;    // |x - mean| / std_dev above which a row is a z-score outlier
+    double madThreshold = 3.5;       // Modified z-score 0.6745 |x - median| / MAD above which a row is a MAD outlier
+    size_t rollingWindow = 0;        // Rows per rolling window for the derived columns, 0 disables them
+    bool allColumns = false;         // Compute statistics for every numeric column instead of the value column only
+    bool correlation = false;        // Write covariance/correlation matrices of the numeric columns
+    bool distinctIds = false;        // Estimate the number of distinct ids with a HyperLogLog sketch
+    size_t topK = 0;                 // Number of most frequent ids to report, 0 disables the heavy-hitter sketch
+    bool groupBy = false;            // Also write per-id count/mean/min/max to a separate groups file
+    char delimiter = 0;              // CSV cell separator, 0 detects it from the file contents
+    OutputMode output = OutputMode::Rewrite;
+    bool incremental = false;        // Persist accumulator state so reruns only parse appended rows (CSV)
+    bool pipeline = false;           // Overlap reading, parsing and aggregating a CSV file on separate threads
+    unsigned threads = 0;            // Worker threads for parallel stages, 0 uses every core
+    uint64_t chunkSize = uint64_t(64) << 20; // Batch files larger than this are parsed in chunks of this many bytes, 0 disables it
+
+    // Counters kept by the heavy-hitter sketch for the requested top-K
+    size_t heavyHitterCapacity() const {
+        return std::max<size_t>(64, 10 * topK);
+    }
+
+    // Whether the MAD and outlier counts are computed
+    bool robustStatistics() const {
+        return robust || writeOutliers;
+    }
+
+    // Number of worker threads to use, resolving 0 to the number of cores
+    unsigned threadCount() const {
+        if (threads != 0) return threads;
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+};
+
+#endif // PROCESSING_OPTIONS_HPP
@@ -0,0 +1,58 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include "ProcessingOptions.hpp"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Persistent record of the files a batch has processed, so files left
+// unchanged since are skipped. An entry keeps the size, modification time
+// and content hash the file had right after its statistics were written, the
+// options it was processed with and the statistics themselves (as JSON).
+// A file counts as unchanged when its size and modification time match;
+// the content hash is checked as well when verification is requested, and
+// for entries recorded so soon after the file's modification time that a
+// later write within the same timestamp tick could have gone unnoticed.
+// Lookups and stores may come from several threads.
+class ResultCache {
+public:
+    explicit ResultCache(const std::string& cachePath, bool verify = false);
+
+    // Whether the file is unchanged since it was stored with these options;
+    // statistics receives what was stored
+    bool lookup(const std::string& path, const ProcessingOptions& options, std::string& statistics);
+
+    // Records the file as processed, as it is on disk now, called right after
+    // its output was written. Nothing is recorded unless the file still has
+    // writtenSize, the size the handler left it with, and stays unchanged
+    // while it is hashed, so rows appended meanwhile are never cached.
+    void store(const std::string& path, const ProcessingOptions& options, std::string statistics, uint64_t writtenSize);
+
+    // Writes the cache file if an entry changed
+    bool save();
+
+    // Text identifying the options that change what is written
+    static std::string signatureOf(const ProcessingOptions& options);
+
+private:
+    struct Entry {
+        std::string signature;
+        uint64_t size = 0;
+        int64_t modified = 0; // Nanoseconds since the epoch
+        int64_t recorded = 0; // When the entry was stored
+        uint64_t hash = 0;
+        std::string statistics;
+    };
+
+    std::string cachePath;
+    bool verify;
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries; // By absolute path
+    bool changed;
+
+    void load();
+};
+
+#endif // RESULT_CACHE_HPP
@@ -0,0 +1,51 @@
+#ifndef ROLLING_STATISTICS_HPP
+#define ROLLING_STATISTICS_HPP
+
+#include <cstddef>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// Statistics over the most recent windowSize values of a stream. Mean and
+// variance are updated incrementally as values enter and leave the window and
+// min/max come from monotonic deques, so every push costs amortised O(1)
+// regardless of the window size.
+class RollingStatistics {
+public:
+    explicit RollingStatistics(size_t windowSize);
+
+    // Adds a value, evicting the oldest one once the window is full
+    void push(double value);
+
+    size_t size() const { return count; }
+    double mean() const { return currentMean; }
+    double std_dev() const;
+    double min() const { return minDeque.front().second; }
+    double max() const { return maxDeque.front().second; }
+
+private:
+    size_t windowSize;
+    std::vector<double> window; // Ring buffer with the values in the window
+    size_t count;               // Number of values currently in the window
+    size_t pushed;              // Number of values pushed so far
+    double currentMean;
+    double m2;                  // Sum of squared deviations from the mean
+
+    // (position, value) pairs with increasing values (min) / decreasing values (max)
+    std::deque<std::pair<size_t, double>> minDeque;
+    std::deque<std::pair<size_t, double>> maxDeque;
+};
+
+// Rolling statistics of the window ending at one row
+struct RollingValues {
+    double mean;
+    double std_dev;
+    double min;
+    double max;
+};
+
+// Rolling statistics for every row. Rows before the window has filled use
+// the rows available so far.
+std::vector<RollingValues> calculateRollingStatistics(const std::vector<double>& values, size_t windowSize);
+
+#endif // ROLLING_STATISTICS_HPP
@@ -0,0 +1,51 @@
+#ifndef SPACE_SAVING_HPP
+#define SPACE_SAVING_HPP
+
+#include "FlatHashMap.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Space-Saving heavy-hitter sketch. At most capacity keys are monitored; an
+// unmonitored key takes over the counter with the smallest count and inherits
+// that count as its possible overestimate. Every key occurring more than
+// total / capacity times is guaranteed to be monitored. The counters form a
+// min-heap, so an update costs O(log capacity).
+class SpaceSaving {
+public:
+    struct Counter {
+        std::string key;
+        uint64_t count = 0; // Estimated occurrences, never below the true count
+        uint64_t error = 0; // Maximum overestimate included in count
+    };
+
+    explicit SpaceSaving(size_t capacity = 64);
+
+    void add(std::string_view key, uint64_t weight = 1);
+
+    // Combines two summaries; keys missing from a full summary are assumed to
+    // have occurred as often as its smallest counter
+    void merge(const SpaceSaving& other);
+
+    // The k keys with the highest estimated counts, highest first
+    std::vector<Counter> top(size_t k) const;
+
+    size_t getCapacity() const { return capacity; }
+
+private:
+    size_t capacity;
+    std::vector<Counter> counters;   // Stable counter slots
+    std::vector<size_t> heap;        // Counter slots ordered as a min-heap by count
+    std::vector<size_t> heapPosition; // Heap position of every counter slot
+    FlatHashMap<std::string, size_t, std::hash<std::string_view>> index; // Key -> counter slot
+
+    uint64_t minimumCount() const;
+    void siftUp(size_t position);
+    void siftDown(size_t position);
+    void swapHeap(size_t a, size_t b);
+    void rebuild(std::vector<Counter> entries);
+};
+
+#endif // SPACE_SAVING_HPP
@@ -0,0 +1,100 @@
+#ifndef STATISTIC_SET_HPP
+#define STATISTIC_SET_HPP
+
+#include "ProcessingOptions.hpp"
+#include "Statistics.hpp"
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+// Tags naming the statistics of a statistic set, e.g. Stats<Mean, StdDev>
+struct Mean { static constexpr unsigned flag = StatMean; };
+struct Median { static constexpr unsigned flag = StatMedian; };
+struct StdDev { static constexpr unsigned flag = StatStdDev; };
+struct Percentiles { static constexpr unsigned flag = StatPercentiles; };
+struct Robust { static constexpr unsigned flag = StatRobust; };
+
+// Computes the statistics selected by Mask (StatisticFlags). Accumulators of
+// unselected statistics are compiled out, and the copy of the values used for
+// selection is only made when the median, percentiles or robust statistics
+// are selected.
+template <unsigned Mask>
+Statistics computeStatistics(const std::vector<double>& values, const ProcessingOptions& options) {
+    constexpr bool robust = (Mask & StatRobust) != 0;
+    constexpr bool needSquares = (Mask & StatStdDev) != 0 || robust;
+    constexpr bool needSum = (Mask & StatMean) != 0 || needSquares;
+    constexpr bool needMedian = (Mask & StatMedian) != 0 || robust;
+    constexpr bool needSelection = needMedian || (Mask & StatPercentiles) != 0;
+
+    Statistics stats;
+    if (values.empty()) return stats;
+
+    // Sum, sum of squares and histogram are all gathered in one pass
+    if (options.histogramDigits > 0) {
+        stats.histogram.emplace(options.histogramDigits);
+    }
+    double sum = 0.0;
+    double sq_sum = 0.0;
+    if (needSum || stats.histogram) {
+        for (double value : values) {
+            if constexpr (needSum) sum += value;
+            if constexpr (needSquares) sq_sum += value * value;
+            if (stats.histogram) stats.histogram->record(value);
+        }
+    }
+
+    // Calculate mean
+    if constexpr (needSum) {
+        stats.mean = sum / values.size();
+    }
+
+    // Calculate standard deviation
+    if constexpr (needSquares) {
+        stats.std_dev = std::sqrt(sq_sum / values.size() - stats.mean * stats.mean);
+    }
+
+    if constexpr (needSelection) {
+        // Median and the requested percentiles come out of one selection pass
+        std::vector<double> requested;
+        if constexpr ((Mask & StatPercentiles) != 0) requested = options.percentiles;
+        if constexpr (needMedian) requested.push_back(50.0);
+        std::vector<double> selected = values;
+        std::vector<double> results = calculatePercentiles(selected, requested);
+
+        if constexpr (needMedian) {
+            stats.median = results.back();
+            results.pop_back();
+        }
+        if constexpr ((Mask & StatPercentiles) != 0) {
+            stats.percentiles = options.percentiles;
+            stats.percentileValues = results;
+        }
+
+        if constexpr (robust) {
+            // The selection buffer is reused in place for the absolute
+            // deviations, so the MAD costs one more selection, not a sort
+            for (double& value : selected) {
+                value = std::fabs(value - stats.median);
+            }
+            stats.mad = calculatePercentiles(selected, {50.0}).front();
+            countOutliers(values, options, stats);
+        }
+    }
+
+    return stats;
+}
+
+// Statistic set fixed at compile time, e.g. Stats<Mean, StdDev>::compute(values)
+template <typename... Selected>
+struct Stats {
+    static constexpr unsigned mask = (0u | ... | Selected::flag);
+
+    template <typename Statistic>
+    static constexpr bool has = (std::is_same_v<Statistic, Selected> || ...);
+
+    static Statistics compute(const std::vector<double>& values, const ProcessingOptions& options = ProcessingOptions()) {
+        return computeStatistics<mask>(values, options);
+    }
+};
+
+#endif // STATISTIC_SET_HPP
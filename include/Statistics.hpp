@@ -0,0 +1,58 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include "Histogram.hpp"
+#include "ProcessingOptions.hpp"
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Row flagged as an outlier by the robust statistics
+struct Outlier {
+    size_t row;   // 0-based data row (JSON array index)
+    double value;
+};
+
+// Summary statistics computed over the value column of a file
+struct Statistics {
+    double mean = 0;
+    double median = 0;
+    double std_dev = 0;
+    std::vector<double> percentiles;      // Requested percentiles (0-100)
+    std::vector<double> percentileValues; // Value of each requested percentile
+    std::optional<Histogram> histogram;   // Distribution of the values, if requested
+    double mad = 0;                       // Median absolute deviation
+    size_t zScoreOutliers = 0;            // Rows beyond the z-score threshold
+    size_t madOutliers = 0;               // Rows beyond the modified z-score threshold
+    std::vector<Outlier> outliers;        // Rows flagged by either test, if requested
+};
+
+// Statistics of one numeric column (CSV) or key (JSON)
+struct ColumnStatistics {
+    size_t column = 0; // Column index in the CSV header
+    std::string name;  // Header cell or JSON key
+    Statistics stats;
+};
+
+// Partially reorders values so that values[r] holds the r-th smallest element
+// for every r in ranks. All ranks are resolved in a single recursive
+// partitioning pass instead of one selection (or a full sort) per rank.
+void selectOrderStatistics(std::vector<double>& values, std::vector<size_t> ranks);
+
+// Computes exact percentiles, interpolating linearly between the two closest
+// ranks. values is reordered in the process.
+std::vector<double> calculatePercentiles(std::vector<double>& values, const std::vector<double>& percentiles);
+
+// Counts the z-score and MAD outliers of values; needs mean, std_dev, median
+// and mad in stats. Collects the flagged rows if options.writeOutliers is set.
+void countOutliers(const std::vector<double>& values, const ProcessingOptions& options, Statistics& stats);
+
+// Calculates the statistics selected in options, dispatching to the
+// pre-instantiated statistic set (see StatisticSet.hpp) for that selection
+Statistics calculateStatistics(const std::vector<double>& values, const ProcessingOptions& options);
+
+// Label used for a percentile in the output files, e.g. "p99" or "p99.9"
+std::string percentileLabel(double percentile);
+
+#endif // STATISTICS_HPP
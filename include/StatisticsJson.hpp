@@ -0,0 +1,31 @@
+#ifndef STATISTICS_JSON_HPP
+#define STATISTICS_JSON_HPP
+
+#include "HyperLogLog.hpp"
+#include "ProcessingOptions.hpp"
+#include "SpaceSaving.hpp"
+#include "Statistics.hpp"
+#include "json.hpp"
+#include <optional>
+#include <string>
+
+// Builds the JSON object holding one set of statistics, with the keys the
+// CSV footer uses as row labels
+nlohmann::json statisticsEntry(const Statistics& stats, const ProcessingOptions& options);
+
+// Adds "distinct_ids" and "top_ids" for the id sketches that are enabled.
+// With jsonIds the sketch keys are serialized JSON values and are parsed
+// back, so ids keep their JSON type.
+void addIdStatistics(nlohmann::json& entry, const std::optional<HyperLogLog>& idSketch,
+                     const std::optional<SpaceSaving>& topIds, const ProcessingOptions& options, bool jsonIds);
+
+// Whether entry has the shape of a statistics entry written by an earlier
+// run: an object without "id" or "value" whose keys are all statistics, or,
+// in all-columns mode, objects of statistics per key
+bool isStatisticsEntry(const nlohmann::json& entry);
+
+// Writes the statistics to "<dataPath>.stats.json", leaving the data file
+// itself untouched
+bool writeStatisticsSidecar(const std::string& dataPath, const nlohmann::json& statsEntry);
+
+#endif // STATISTICS_JSON_HPP
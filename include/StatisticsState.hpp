@@ -0,0 +1,50 @@
+#ifndef STATISTICS_STATE_HPP
+#define STATISTICS_STATE_HPP
+
+#include "Histogram.hpp"
+#include "HyperLogLog.hpp"
+#include "ProcessingOptions.hpp"
+#include "Statistics.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Mergeable accumulators of the value column of an append-only file, saved
+// next to it together with the byte offset processed so far. A later run
+// loads the state, parses only the rows appended since and merges them in.
+//
+// The state lives in "<file>.state" (text). The median and percentiles
+// cannot be merged from summaries, so runs that select them never use it.
+struct StatisticsState {
+    std::string signature;   // Options the accumulators were built with
+    uint64_t dataEnd = 0;    // Byte offset just past the last processed data row
+    uint64_t footerSize = 0; // Bytes of the statistics footer written at dataEnd
+    uint64_t footerHash = 0; // hash64 of that footer, to detect edited files
+    uint64_t count = 0;
+    double mean = 0;
+    double m2 = 0;           // Sum of squared deviations from the mean
+    std::optional<Histogram> histogram;
+    std::optional<HyperLogLog> idSketch;
+
+    // Starts an empty state for the given options
+    explicit StatisticsState(const ProcessingOptions& options = ProcessingOptions());
+
+    // Merges a batch of values into the accumulators (Chan et al. update)
+    void add(const std::vector<double>& values);
+
+    // Mean / std_dev / histogram of everything added so far
+    Statistics statistics() const;
+
+    // Whether the median or percentiles are selected, which need every value
+    static bool needsValues(const ProcessingOptions& options);
+
+    // Options that change the accumulators, as stored in the state file
+    static std::string signatureOf(const ProcessingOptions& options);
+
+    // Contents of the state file
+    std::string serialize() const;
+    static bool load(const std::string& statePath, StatisticsState& state);
+};
+
+#endif // STATISTICS_STATE_HPP
@@ -0,0 +1,73 @@
+#ifndef TASK_SCHEDULER_HPP
+#define TASK_SCHEDULER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool of worker threads. Every worker has its own deque: tasks
+// submitted from inside a task go to the back of the submitting worker's
+// deque and are run newest first, so a task's children stay on the core
+// whose cache they share. A worker whose deque is empty steals the oldest
+// task of another worker, which for a split file is its largest remaining
+// piece of work. Tasks submitted from outside are dealt round robin.
+class TaskScheduler {
+public:
+    using Task = std::function<void()>;
+
+    explicit TaskScheduler(unsigned threads);
+
+    // Waits for every task, then stops the workers
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Queues a task; may be called from inside a running task
+    void submit(Task task);
+
+    // Blocks until every submitted task, including the tasks those tasks
+    // submitted, has finished
+    void wait();
+
+    unsigned threadCount() const { return static_cast<unsigned>(workers.size()); }
+
+    // Index of the worker running the calling task, or threadCount() when
+    // called from outside this scheduler's tasks
+    size_t workerIndex() const;
+
+    // Messages of the exceptions tasks ended with since the last call; the
+    // scheduler never prints, the caller reports them
+    std::vector<std::string> takeErrors();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex stateMutex;
+    std::condition_variable taskQueued;
+    std::condition_variable allDone;
+    std::atomic<size_t> queued;  // Tasks waiting in a deque
+    std::atomic<size_t> pending; // Tasks submitted and not yet finished
+    std::atomic<size_t> nextQueue;
+    bool stopping;
+    std::vector<std::string> errors; // Guarded by stateMutex
+
+    void run(size_t self);
+
+    // Takes a task from the back of the own deque or the front of another one
+    bool take(size_t self, Task& task);
+};
+
+#endif // TASK_SCHEDULER_HPP
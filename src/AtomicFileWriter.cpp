@@ -0,0 +1,304 @@
+#include "AtomicFileWriter.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#include <random>
+#endif
+
+namespace {
+
+const size_t pageSize = 4096;
+
+#ifdef __linux__
+// Writes all of data, retrying after short writes and signals
+bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+std::string directoryOf(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+#endif
+
+} // namespace
+
+AtomicFileWriter::Buffer::Buffer(size_t size)
+    : data(nullptr, std::free), size((std::max(size, pageSize) + pageSize - 1) / pageSize * pageSize) {
+#ifdef __linux__
+    data.reset(static_cast<char*>(std::aligned_alloc(pageSize, this->size)));
+#else
+    data.reset(static_cast<char*>(std::malloc(this->size)));
+#endif
+    if (!data) {
+        failed = true;
+        return;
+    }
+    setp(data.get(), data.get() + this->size);
+}
+
+AtomicFileWriter::Buffer::~Buffer() {
+#ifdef __linux__
+    if (fd >= 0) ::close(fd);
+#endif
+}
+
+bool AtomicFileWriter::Buffer::flush() {
+    size_t pending = static_cast<size_t>(pptr() - pbase());
+    if (pending == 0) return !failed;
+#ifdef __linux__
+    if (fd < 0 || !writeAll(fd, pbase(), pending)) failed = true;
+#else
+    if (!file.is_open() || !file.write(pbase(), static_cast<std::streamsize>(pending))) failed = true;
+#endif
+    flushed += pending;
+    setp(data.get(), data.get() + size);
+    return !failed;
+}
+
+AtomicFileWriter::Buffer::int_type AtomicFileWriter::Buffer::overflow(int_type c) {
+    if (!flush() || !data) return traits_type::eof();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int AtomicFileWriter::Buffer::sync() {
+    return flush() ? 0 : -1;
+}
+
+AtomicFileWriter::Buffer::pos_type AtomicFileWriter::Buffer::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode mode) {
+    // Only reports the position (tellp); the output is written sequentially
+    if (offset != 0 || direction != std::ios_base::cur || !(mode & std::ios_base::out)) {
+        return pos_type(off_type(-1));
+    }
+    return pos_type(static_cast<off_type>(flushed + static_cast<uint64_t>(pptr() - pbase())));
+}
+
+#ifdef __linux__
+
+AtomicFileWriter::AtomicFileWriter(const std::string& path, size_t bufferSize)
+    : std::ostream(nullptr), buffer(bufferSize), path(path), committed(false) {
+    rdbuf(&buffer);
+
+    // Same directory as the target, so the rename never crosses filesystems
+    std::vector<char> pattern(path.begin(), path.end());
+    const std::string suffix = ".tmpXXXXXX";
+    pattern.insert(pattern.end(), suffix.begin(), suffix.end());
+    pattern.push_back('\0');
+    buffer.fd = ::mkstemp(pattern.data());
+    if (buffer.fd < 0) {
+        setstate(std::ios::badbit);
+        return;
+    }
+    tempPath = pattern.data();
+
+    // Keep the permissions of the file being replaced
+    struct stat original;
+    mode_t mode = 0644;
+    if (::stat(path.c_str(), &original) == 0) {
+        mode = original.st_mode & 07777;
+    }
+    else {
+        mode_t mask = ::umask(0);
+        ::umask(mask);
+        mode = 0666 & ~mask;
+    }
+    ::fchmod(buffer.fd, mode);
+}
+
+AtomicFileWriter::~AtomicFileWriter() {
+    if (!committed && !tempPath.empty()) {
+        std::remove(tempPath.c_str());
+    }
+}
+
+bool AtomicFileWriter::copyFrom(const std::string& sourcePath, uint64_t length) {
+    if (length == 0) return true;
+    if (!isOpen() || !buffer.flush()) return false;
+
+    int source = ::open(sourcePath.c_str(), O_RDONLY);
+    if (source < 0) {
+        setstate(std::ios::badbit);
+        return false;
+    }
+
+    loff_t offset = 0;
+    uint64_t remaining = length;
+    bool inKernel = true;
+    std::vector<char> chunk;
+    while (remaining > 0) {
+        ssize_t copied = -1;
+        if (inKernel) {
+            copied = ::copy_file_range(source, &offset, buffer.fd, nullptr, remaining, 0);
+            if (copied < 0 && errno == EINTR) continue;
+            if (copied < 0) {
+                // Not supported for this pair of files; copy through user space
+                inKernel = false;
+                continue;
+            }
+        }
+        else {
+            if (chunk.empty()) chunk.resize(size_t(1) << 20);
+            size_t wanted = static_cast<size_t>(std::min<uint64_t>(remaining, chunk.size()));
+            copied = ::pread(source, chunk.data(), wanted, offset);
+            if (copied > 0 && !writeAll(buffer.fd, chunk.data(), static_cast<size_t>(copied))) copied = -1;
+            if (copied > 0) offset += copied;
+            if (copied < 0 && errno == EINTR) continue;
+        }
+        if (copied < 0) break;
+        if (copied == 0) break; // Source shorter than expected
+        remaining -= static_cast<uint64_t>(copied);
+        buffer.flushed += static_cast<uint64_t>(copied);
+    }
+    ::close(source);
+
+    if (remaining > 0) {
+        setstate(std::ios::badbit);
+        return false;
+    }
+    return true;
+}
+
+bool AtomicFileWriter::commit() {
+    if (!isOpen() || committed) return false;
+
+    bool written = buffer.flush() && !fail() && ::fsync(buffer.fd) == 0;
+    written = ::close(buffer.fd) == 0 && written;
+    buffer.fd = -1;
+    if (!written || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        return false;
+    }
+    committed = true;
+
+    // Persist the directory entry of the renamed file as well
+    int directory = ::open(directoryOf(path).c_str(), O_RDONLY | O_DIRECTORY);
+    if (directory >= 0) {
+        ::fsync(directory);
+        ::close(directory);
+    }
+    return true;
+}
+
+bool replaceFileTail(const std::string& path, uint64_t offset, std::string_view tail) {
+    int fd = ::open(path.c_str(), O_WRONLY);
+    if (fd < 0) return false;
+    bool written = ::lseek(fd, static_cast<off_t>(offset), SEEK_SET) >= 0 &&
+                   writeAll(fd, tail.data(), tail.size()) &&
+                   ::ftruncate(fd, static_cast<off_t>(offset + tail.size())) == 0 &&
+                   ::fsync(fd) == 0;
+    return ::close(fd) == 0 && written;
+}
+
+#else
+
+AtomicFileWriter::AtomicFileWriter(const std::string& path, size_t bufferSize)
+    : std::ostream(nullptr), buffer(bufferSize), path(path), committed(false) {
+    rdbuf(&buffer);
+
+    // Same directory and name pattern as mkstemp would give
+    const char letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+    std::random_device random;
+    for (int attempt = 0; attempt < 100 && !buffer.isOpen(); ++attempt) {
+        std::string candidate = path + ".tmp";
+        for (int i = 0; i < 6; ++i) candidate += letters[random() % (sizeof(letters) - 1)];
+        std::error_code error;
+        if (std::filesystem::exists(candidate, error) || error) continue;
+        buffer.file.open(candidate, std::ios::binary | std::ios::trunc);
+        if (buffer.isOpen()) tempPath = candidate;
+    }
+    if (!buffer.isOpen()) {
+        setstate(std::ios::badbit);
+        return;
+    }
+
+    // Keep the permissions of the file being replaced
+    std::error_code error;
+    std::filesystem::file_status original = std::filesystem::status(path, error);
+    if (!error && std::filesystem::exists(original)) {
+        std::filesystem::permissions(tempPath, original.permissions(), error);
+    }
+}
+
+AtomicFileWriter::~AtomicFileWriter() {
+    if (!committed && !tempPath.empty()) {
+        if (buffer.file.is_open()) buffer.file.close();
+        std::remove(tempPath.c_str());
+    }
+}
+
+bool AtomicFileWriter::copyFrom(const std::string& sourcePath, uint64_t length) {
+    if (length == 0) return true;
+    if (!isOpen() || !buffer.flush()) return false;
+
+    std::ifstream source(sourcePath, std::ios::binary);
+    std::vector<char> chunk(static_cast<size_t>(std::min<uint64_t>(length, uint64_t(1) << 20)));
+    uint64_t remaining = length;
+    while (remaining > 0 && source) {
+        size_t wanted = static_cast<size_t>(std::min<uint64_t>(remaining, chunk.size()));
+        source.read(chunk.data(), static_cast<std::streamsize>(wanted));
+        size_t copied = static_cast<size_t>(source.gcount());
+        if (copied == 0) break; // Source shorter than expected
+        if (!buffer.file.write(chunk.data(), static_cast<std::streamsize>(copied))) break;
+        remaining -= copied;
+        buffer.flushed += copied;
+    }
+
+    if (remaining > 0) {
+        setstate(std::ios::badbit);
+        return false;
+    }
+    return true;
+}
+
+bool AtomicFileWriter::commit() {
+    if (!isOpen() || committed) return false;
+
+    bool written = buffer.flush() && !fail() && buffer.file.flush();
+    buffer.file.close();
+    written = written && !buffer.file.fail();
+    if (!written) return false;
+
+    // Unlike std::rename, this replaces an existing target on every platform
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) return false;
+    committed = true;
+    return true;
+}
+
+bool replaceFileTail(const std::string& path, uint64_t offset, std::string_view tail) {
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        if (!file.is_open()) return false;
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.write(tail.data(), static_cast<std::streamsize>(tail.size()));
+        if (!file.flush()) return false;
+    }
+    std::error_code error;
+    std::filesystem::resize_file(path, offset + tail.size(), error);
+    return !error;
+}
+
+#endif
@@ -0,0 +1,450 @@
+#include "BatchProcessor.hpp"
+#include "CsvFileHandlerCreator.hpp"
+#include "FileBatchReader.hpp"
+#include "JsonFileHandlerCreator.hpp"
+#include "NdjsonFileHandlerCreator.hpp"
+#include "PathPattern.hpp"
+#include "TaskScheduler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+// Files up to this size are read ahead by the FileBatchReader, at most
+// prefetchBudget bytes of them waiting for a worker at any time
+const uint64_t prefetchLimit = uint64_t(1) << 20;
+const uint64_t prefetchBudget = uint64_t(64) << 20;
+
+// Handlers of files up to this size go back to their worker's pool; larger
+// ones are freed rather than keeping their buffers for the rest of the run
+const uint64_t poolLimit = uint64_t(16) << 20;
+
+// What the handlers append to the name of a data file for their side files
+const char* const sideFileSuffixes[] = {".stats.json", ".groups.csv", ".groups.json", ".outliers.csv", ".outliers.json",
+                                        ".covariance.csv", ".correlation.csv", ".correlation.json", ".state", ".state.tail"};
+
+// Length of the random part of an AtomicFileWriter temporary file name
+const size_t tempNameLength = 6;
+
+// Format a file is taken for when sniffing its contents is inconclusive
+FileFormat formatOfExtension(const std::string& extension) {
+    if (extension == "csv" || extension == "tsv") return FileFormat::Csv;
+    if (extension == "json") return FileFormat::Json;
+    if (extension == "ndjson" || extension == "jsonl") return FileFormat::Ndjson;
+    return FileFormat::Unknown;
+}
+
+bool isSupported(const std::string& filePath) {
+    return formatOfExtension(getFileExtension(filePath)) != FileFormat::Unknown;
+}
+
+// Side files are named after their data file, e.g. data.csv.stats.json, and
+// so are the temporary files an AtomicFileWriter renames over a file once it
+// is complete, e.g. data.csv.tmpA1b2C3. Other names with a data extension in
+// the middle, such as export.csv.2024.csv, are data.
+bool isSideFile(const std::string& fileName) {
+    size_t temp = fileName.rfind(".tmp");
+    if (temp != std::string::npos && fileName.size() == temp + 4 + tempNameLength && isSupported(fileName.substr(0, temp))) {
+        return true;
+    }
+    for (std::string_view suffix : sideFileSuffixes) {
+        if (fileName.ends_with(suffix) && isSupported(fileName.substr(0, fileName.size() - suffix.size()))) return true;
+    }
+    return false;
+}
+
+// Creators of the handlers by format, with the built-in ones registered
+std::map<FileFormat, FileHandlerFactory>& handlerRegistry() {
+    static std::map<FileFormat, FileHandlerFactory> registry = {
+        {FileFormat::Csv, [](const ProcessingOptions& options) { return std::make_unique<CsvFileHandlerCreator>(options); }},
+        {FileFormat::Json, [](const ProcessingOptions& options) { return std::make_unique<JsonFileHandlerCreator>(options); }},
+        {FileFormat::Ndjson, [](const ProcessingOptions& options) { return std::make_unique<NdjsonFileHandlerCreator>(options); }}
+    };
+    return registry;
+}
+
+void addDirectory(const std::string& directory, std::vector<std::string>& files) {
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (!it->is_regular_file(error)) continue;
+        std::string path = it->path().string();
+        if (isBatchInput(path)) {
+            files.push_back(path);
+        }
+    }
+}
+
+void addPath(const std::string& path, std::vector<std::string>& files) {
+    std::error_code error;
+    if (std::filesystem::is_directory(path, error)) {
+        addDirectory(path, files);
+    }
+    else {
+        files.push_back(path);
+    }
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Records the outcome of a handler that ran to the end, and caches it as
+// the file is right after the write, before anything else can change it
+void finish(FileResult& result, const FileHandler& handler, ResultCache* cache, const ProcessingOptions& options) {
+    // A processed file may still report a side file it could not write
+    result.message = handler.errorMessage();
+    if (handler.succeeded()) {
+        result.status = FileResult::Processed;
+        result.statistics = handler.summary();
+        std::optional<uint64_t> size = handler.writtenSize();
+        FileVersion version;
+        if (size && currentVersion(result.path, version) && version.size == *size) result.written = version;
+        if (cache && size) cache->store(result.path, options, result.statistics, *size);
+    }
+    else if (result.message.empty()) {
+        result.message = "no statistics computed";
+    }
+}
+
+// Reads, processes and writes a file in one go; contents, if given, is the
+// file as read ahead by the caller
+void processWhole(FileHandler& handler, std::string* contents) {
+    if (!contents || !handler.readContents(std::move(*contents))) {
+        handler.readData();
+    }
+    handler.process();
+    handler.writeData();
+}
+
+// Submits the tasks of one file: a single task that reads, processes and
+// writes it, or, for a file the handler splits, one parse task per chunk
+// followed by a merge task, queued by the last chunk to finish, that
+// combines them and writes the output
+void submitFile(TaskScheduler& scheduler, std::vector<HandlerPool>& pools, ResultCache* cache, const std::string& path, uint64_t size,
+                const ProcessingOptions& options, FileResult& result) {
+    scheduler.submit([&scheduler, &pools, cache, &path, size, &options, &result]() {
+        auto start = std::chrono::steady_clock::now();
+        result.path = path;
+
+        std::unique_ptr<FileHandlerCreator> creator = createFileHandlerCreator(path, options, &result.message);
+        if (!creator) {
+            result.status = FileResult::Unsupported;
+            result.seconds = secondsSince(start);
+            return;
+        }
+
+        std::shared_ptr<FileHandler> handler;
+        size_t chunks = 0;
+        try {
+            // Whole files are read by a pooled handler; a split file's handler
+            // is shared by its chunk tasks
+            HandlerPool& pool = pools[scheduler.workerIndex()];
+            std::unique_ptr<FileHandler> whole = pool.acquire(*creator, path);
+            chunks = whole->prepareChunks(options.chunkSize);
+            if (chunks == 0) {
+                processWhole(*whole, nullptr);
+                finish(result, *whole, cache, options);
+                if (size <= poolLimit) pool.release(*creator, std::move(whole));
+            }
+            else {
+                handler = std::move(whole);
+            }
+        }
+        catch (const std::exception& e) {
+            result.message = e.what();
+            chunks = 0;
+        }
+        if (chunks == 0) {
+            result.seconds = secondsSince(start);
+            return;
+        }
+
+        // Each chunk task records its own failure; the merge, queued once all
+        // of them are done either way, reports the first
+        auto remaining = std::make_shared<std::atomic<size_t>>(chunks);
+        auto errors = std::make_shared<std::vector<std::string>>(chunks);
+        auto merge = [handler, errors, start, cache, &options, &result]() {
+            auto error = std::find_if(errors->begin(), errors->end(), [](const std::string& message) { return !message.empty(); });
+            if (error != errors->end()) {
+                result.message = *error;
+                result.seconds = secondsSince(start);
+                return;
+            }
+            try {
+                handler->mergeChunks();
+                handler->writeData();
+                finish(result, *handler, cache, options);
+            }
+            catch (const std::exception& e) {
+                result.message = e.what();
+            }
+            result.seconds = secondsSince(start);
+        };
+        for (size_t i = 0; i < chunks; ++i) {
+            scheduler.submit([&scheduler, handler, remaining, errors, merge, i]() {
+                try {
+                    handler->parseChunk(i);
+                }
+                catch (const std::exception& e) {
+                    (*errors)[i] = e.what();
+                }
+                if (--*remaining == 0) scheduler.submit(merge);
+            });
+        }
+    });
+}
+
+// Reads the files with a FileBatchReader on this thread and submits one task
+// per file as soon as its contents are in memory, so the workers parse while
+// the next files are still being read. Returns once every task finished.
+void submitReadAhead(TaskScheduler& scheduler, FileBatchReader& reader, std::vector<HandlerPool>& pools, ResultCache* cache, const std::vector<std::string>& files,
+                     const std::vector<size_t>& indices, const ProcessingOptions& options, std::vector<FileResult>& results) {
+    std::vector<std::string> paths;
+    for (size_t i : indices) paths.push_back(files[i]);
+
+    std::mutex mutex;
+    std::condition_variable released;
+    uint64_t buffered = 0;
+    reader.readAll(paths, [&](size_t k, std::string&& data, int error) {
+        uint64_t size = data.size();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            released.wait(lock, [&]() { return buffered < prefetchBudget; });
+            buffered += size;
+        }
+
+        size_t i = indices[k];
+        auto contents = std::make_shared<std::string>(std::move(data));
+        scheduler.submit([&, i, contents, error, size]() {
+            auto start = std::chrono::steady_clock::now();
+            FileResult& result = results[i];
+            result.path = files[i];
+            if (error != 0) {
+                result.message = std::strerror(error);
+            }
+            else {
+                try {
+                    std::unique_ptr<FileHandlerCreator> creator = createFileHandlerCreator(files[i], *contents, options, &result.message);
+                    if (creator) {
+                        HandlerPool& pool = pools[scheduler.workerIndex()];
+                        std::unique_ptr<FileHandler> handler = pool.acquire(*creator, files[i]);
+                        processWhole(*handler, contents.get());
+                        finish(result, *handler, cache, options);
+                        pool.release(*creator, std::move(handler));
+                    }
+                    else {
+                        result.status = FileResult::Unsupported;
+                    }
+                }
+                catch (const std::exception& e) {
+                    result.message = e.what();
+                }
+            }
+            result.seconds = secondsSince(start);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                buffered -= size;
+            }
+            released.notify_one();
+        });
+    });
+    scheduler.wait();
+}
+
+} // namespace
+
+std::unique_ptr<FileHandler> HandlerPool::acquire(FileHandlerCreator& creator, const std::string& filePath) {
+    auto spare = spares.find(std::type_index(typeid(creator)));
+    if (spare == spares.end() || !spare->second) return creator.createFileHandler(filePath);
+    return creator.reuseFileHandler(std::move(spare->second), filePath);
+}
+
+void HandlerPool::release(const FileHandlerCreator& creator, std::unique_ptr<FileHandler> handler) {
+    spares[std::type_index(typeid(creator))] = std::move(handler);
+}
+
+bool currentVersion(const std::string& path, FileVersion& version) {
+    std::error_code error;
+    version.size = std::filesystem::file_size(path, error);
+    if (!error) version.modified = std::filesystem::last_write_time(path, error);
+    return !error;
+}
+
+std::string getFileExtension(const std::string& filePath) {
+    size_t dotPosition = filePath.find_last_of('.');
+    if (dotPosition != std::string::npos) {
+        return filePath.substr(dotPosition+1);
+    }
+    return ""; // Return empty string if no extension found
+}
+
+void registerFileHandlerCreator(FileFormat format, FileHandlerFactory factory) {
+    handlerRegistry()[format] = std::move(factory);
+}
+
+std::unique_ptr<FileHandlerCreator> createFileHandlerCreator(const std::string& filePath, const ProcessingOptions& options,
+                                                             std::string* reason) {
+    return createFileHandlerCreator(filePath, sniffFile(filePath), options, reason);
+}
+
+std::unique_ptr<FileHandlerCreator> createFileHandlerCreator(const std::string& filePath, std::string_view head, const ProcessingOptions& options,
+                                                             std::string* reason) {
+    return createFileHandlerCreator(filePath, sniffContents(head), options, reason);
+}
+
+std::unique_ptr<FileHandlerCreator> createFileHandlerCreator(const std::string& filePath, const SniffResult& sniffed, const ProcessingOptions& options,
+                                                             std::string* reason) {
+    auto unsupported = [reason](const std::string& message) {
+        if (reason) *reason = message;
+        return nullptr;
+    };
+    if (sniffed.format == FileFormat::Compressed) {
+        return unsupported("compressed (" + sniffed.compression + ") files are not supported");
+    }
+
+    // The extension decides, apart from ".json", which is also used for
+    // one object per line. Contents of the other family are an error rather
+    // than a reason to rewrite a file in a format it is not in.
+    std::string extension = getFileExtension(filePath);
+    FileFormat format = formatOfExtension(extension);
+    bool jsonFamily = sniffed.format == FileFormat::Json || sniffed.format == FileFormat::Ndjson;
+    if (format == FileFormat::Unknown || (extension == "json" && jsonFamily)) {
+        format = sniffed.format;
+    }
+    else if (sniffed.format != FileFormat::Unknown && (format == FileFormat::Csv) == jsonFamily) {
+        return unsupported("contents do not match the ." + extension + " extension");
+    }
+    auto found = handlerRegistry().find(format);
+    if (found == handlerRegistry().end()) {
+        return unsupported("unsupported file type");
+    }
+
+    // A delimiter given on the command line wins over the sniffed one
+    ProcessingOptions formatOptions = options;
+    if (format == FileFormat::Csv && formatOptions.delimiter == 0) {
+        if (sniffed.format == FileFormat::Csv) formatOptions.delimiter = sniffed.delimiter;
+        else if (extension == "tsv") formatOptions.delimiter = '\t';
+    }
+    return found->second(formatOptions);
+}
+
+bool isBatchInput(const std::string& path) {
+    return isSupported(path) && !isSideFile(std::filesystem::path(path).filename().string());
+}
+
+std::vector<std::string> expandInputs(const std::vector<std::string>& inputs) {
+    std::vector<std::string> files;
+    for (const auto& input : inputs) {
+        if (!hasWildcards(input)) {
+            addPath(input, files);
+            continue;
+        }
+
+        for (const auto& path : expandPattern(input)) {
+            std::error_code error;
+            if (std::filesystem::is_directory(path, error)) {
+                addDirectory(path, files);
+            }
+            else if (!isSideFile(std::filesystem::path(path).filename().string())) {
+                files.push_back(path);
+            }
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    return files;
+}
+
+std::vector<FileResult> processBatch(const std::vector<std::string>& files, const ProcessingOptions& options) {
+    BatchResources resources(options.threadCount());
+    return processBatch(files, options, resources);
+}
+
+std::vector<FileResult> processBatch(const std::vector<std::string>& files, const ProcessingOptions& options, BatchResources& resources) {
+    unsigned workers = resources.scheduler.threadCount();
+    ProcessingOptions fileOptions = options;
+    fileOptions.threads = std::max<unsigned>(1, workers / std::max<size_t>(1, files.size()));
+
+    // Largest files first, so their chunks are spread over the workers early
+    // and the small files fill the gaps at the end
+    std::vector<uint64_t> sizes(files.size());
+    std::vector<size_t> order(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::error_code error;
+        sizes[i] = std::filesystem::file_size(files[i], error);
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    std::vector<FileResult> results(files.size());
+    TaskScheduler& scheduler = resources.scheduler;
+    ResultCache* cache = resources.cache.get();
+    std::vector<char> cached(files.size(), 0);
+    if (cache) {
+        // Lookups only stat the file, unless its content hash is checked
+        for (size_t i : order) {
+            scheduler.submit([&, i]() {
+                if (!cache->lookup(files[i], options, results[i].statistics)) return;
+                results[i].path = files[i];
+                results[i].status = FileResult::Processed;
+                results[i].message = "unchanged";
+                cached[i] = 1;
+            });
+        }
+        scheduler.wait();
+        order.erase(std::remove_if(order.begin(), order.end(), [&cached](size_t i) { return cached[i]; }), order.end());
+    }
+
+    // Small files are read ahead in batches; the others are read by their
+    // handlers on the workers, or split into chunks
+    std::vector<size_t> readAhead;
+    for (size_t i : order) {
+        bool small = sizes[i] <= prefetchLimit && (options.chunkSize == 0 || sizes[i] <= options.chunkSize);
+        if (small && isSupported(files[i])) {
+            readAhead.push_back(i);
+        }
+        else {
+            submitFile(scheduler, resources.handlers, cache, files[i], sizes[i], fileOptions, results[i]);
+        }
+    }
+    submitReadAhead(scheduler, resources.reader, resources.handlers, cache, files, readAhead, fileOptions, results);
+    if (cache) cache->save();
+    return results;
+}
+
+void printBatchReport(std::ostream& out, const std::vector<FileResult>& results, double seconds, unsigned workers) {
+    size_t processed = 0;
+    size_t failed = 0;
+    size_t skipped = 0;
+    for (const auto& result : results) {
+        const char* label = "OK";
+        if (result.status == FileResult::Processed) {
+            ++processed;
+        }
+        else if (result.status == FileResult::Failed) {
+            label = "FAILED";
+            ++failed;
+        }
+        else {
+            label = "SKIPPED";
+            ++skipped;
+        }
+        out << std::left << std::setw(8) << label << std::right << std::fixed << std::setprecision(3)
+            << std::setw(9) << result.seconds << "s  " << result.path;
+        if (!result.message.empty()) out << " (" << result.message << ")";
+        out << "\n";
+    }
+    out << results.size() << " files in " << std::fixed << std::setprecision(3) << seconds << "s on " << workers
+        << " workers: " << processed << " processed, " << failed << " failed, " << skipped << " skipped" << std::endl;
+}
@@ -0,0 +1,118 @@
+#include "CovarianceMatrix.hpp"
+#include "Parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Rows per block; the centred block of every column stays in cache
+const size_t blockRows = 256;
+
+// Rows per parallel chunk
+const size_t chunkRows = 1 << 16;
+
+} // namespace
+
+CovarianceMatrix::CovarianceMatrix(size_t columns)
+    : columns(columns), count(0), means(columns, 0.0), comoments(columns * columns, 0.0) {}
+
+void CovarianceMatrix::addRows(const std::vector<const double*>& data, size_t begin, size_t end) {
+    std::vector<double> centred(columns * blockRows);
+    std::vector<double> blockMeans(columns);
+    std::vector<double> blockComoments(columns * columns);
+
+    for (size_t start = begin; start < end; start += blockRows) {
+        size_t rows = std::min(blockRows, end - start);
+
+        // Centre each column of the block on the block mean
+        for (size_t c = 0; c < columns; ++c) {
+            const double* x = data[c] + start;
+            double sum = 0.0;
+            for (size_t r = 0; r < rows; ++r) sum += x[r];
+            blockMeans[c] = sum / rows;
+
+            double* out = &centred[c * blockRows];
+            for (size_t r = 0; r < rows; ++r) out[r] = x[r] - blockMeans[c];
+        }
+
+        // Upper triangle of the block co-moments, mirrored afterwards
+        for (size_t i = 0; i < columns; ++i) {
+            const double* a = &centred[i * blockRows];
+            for (size_t j = i; j < columns; ++j) {
+                const double* b = &centred[j * blockRows];
+                double sum = 0.0;
+                for (size_t r = 0; r < rows; ++r) sum += a[r] * b[r];
+                blockComoments[i * columns + j] = sum;
+                blockComoments[j * columns + i] = sum;
+            }
+        }
+
+        mergeMoments(rows, blockMeans, blockComoments);
+    }
+}
+
+void CovarianceMatrix::merge(const CovarianceMatrix& other) {
+    if (other.columns != columns) return;
+    mergeMoments(other.count, other.means, other.comoments);
+}
+
+void CovarianceMatrix::mergeMoments(size_t otherCount, const std::vector<double>& otherMeans,
+                                    const std::vector<double>& otherComoments) {
+    if (otherCount == 0) return;
+    if (count == 0) {
+        count = otherCount;
+        means = otherMeans;
+        comoments = otherComoments;
+        return;
+    }
+
+    double total = static_cast<double>(count + otherCount);
+    double weight = static_cast<double>(count) * otherCount / total;
+    std::vector<double> delta(columns);
+    for (size_t c = 0; c < columns; ++c) {
+        delta[c] = otherMeans[c] - means[c];
+    }
+    for (size_t i = 0; i < columns; ++i) {
+        for (size_t j = 0; j < columns; ++j) {
+            comoments[i * columns + j] += otherComoments[i * columns + j] + delta[i] * delta[j] * weight;
+        }
+    }
+    for (size_t c = 0; c < columns; ++c) {
+        means[c] += delta[c] * otherCount / total;
+    }
+    count += otherCount;
+}
+
+double CovarianceMatrix::covariance(size_t i, size_t j) const {
+    if (count == 0) return std::numeric_limits<double>::quiet_NaN();
+    return comoments[i * columns + j] / count;
+}
+
+double CovarianceMatrix::correlation(size_t i, size_t j) const {
+    double denominator = std::sqrt(comoments[i * columns + i] * comoments[j * columns + j]);
+    if (count == 0 || denominator == 0.0) return std::numeric_limits<double>::quiet_NaN();
+    return comoments[i * columns + j] / denominator;
+}
+
+CovarianceMatrix calculateCovariance(const std::vector<std::vector<double>>& columns, unsigned threads) {
+    size_t rows = columns.empty() ? 0 : columns.front().size();
+    std::vector<const double*> data;
+    for (const auto& column : columns) {
+        data.push_back(column.data());
+    }
+
+    // Every chunk gets its own accumulator; they are merged in chunk order
+    size_t chunks = (rows + chunkRows - 1) / chunkRows;
+    std::vector<CovarianceMatrix> partials(chunks, CovarianceMatrix(columns.size()));
+    parallelFor(chunks, threads, [&](size_t chunk) {
+        size_t begin = chunk * chunkRows;
+        partials[chunk].addRows(data, begin, std::min(rows, begin + chunkRows));
+    });
+
+    CovarianceMatrix result(columns.size());
+    for (const auto& partial : partials) {
+        result.merge(partial);
+    }
+    return result;
+}
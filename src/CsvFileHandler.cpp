@@ -1,114 +1,1034 @@
 #include "CsvFileHandler.hpp"
+#include "AtomicFileWriter.hpp"
+#include "BoundedQueue.hpp"
+#include "Hash.hpp"
+#include "OutputBuffer.hpp"
+#include "Parallel.hpp"
+#include "StatisticsJson.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
-#include <iostream>
 #include <algorithm>
-#include <cmath>
-#include <numeric>
+#include <limits>
+#include <optional>
+
+namespace {
+
+// Splits line at the delimiter into row, assigning to the cells it already
+// has so their storage is reused. A trailing delimiter adds no empty cell.
+void splitRow(std::string_view line, char delimiter, std::vector<std::string>& row) {
+    size_t cells = 0;
+    for (size_t start = 0; start < line.size(); ++cells) {
+        size_t end = std::min(line.find(delimiter, start), line.size());
+        if (cells == row.size()) row.emplace_back();
+        row[cells].assign(line.data() + start, end - start);
+        start = end + 1;
+    }
+    row.resize(cells);
+}
+
+// Whether the first length bytes of a file are empty or end with a newline
+bool endsWithNewline(const std::string& path, uint64_t length) {
+    if (length == 0) return true;
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(length - 1));
+    return file.get() == '\n';
+}
+
+// Single-column statistics of the value column, without derived outputs
+bool valueColumnOnly(const ProcessingOptions& options) {
+    return !options.allColumns && !options.correlation && options.rollingWindow == 0 &&
+           !options.groupBy && options.topK == 0 && !options.robustStatistics();
+}
+
+// Incremental runs keep mergeable accumulators only; selection statistics
+// would need every value again
+bool supportsIncremental(const ProcessingOptions& options) {
+    return valueColumnOnly(options) && !StatisticsState::needsValues(options);
+}
+
+// Chunks parse the value column and id sketch only, and the file as read
+bool supportsChunking(const ProcessingOptions& options) {
+    return valueColumnOnly(options) && !(options.incremental && supportsIncremental(options));
+}
+
+// Signature of a state that only records where a non-incremental run wrote
+// its footer; it never matches the options of an incremental run
+const char* const footerSignature = "footer";
+
+// Bytes per read of the pipelined reader, and buffers in flight per queue
+const size_t pipelineBlockSize = size_t(1) << 20;
+const size_t pipelineDepth = 4;
+
+} // namespace
 
 // Constructor initializing member variables
-CsvFileHandler::CsvFileHandler(const std::string& filePath)
-    : filePath(filePath), mean(0), median(0), std_dev(0), hasInvalidData(false) {}
+CsvFileHandler::CsvFileHandler(const std::string& filePath, const ProcessingOptions& options)
+    : filePath(filePath), options(options), delimiter(options.delimiter ? options.delimiter : ','), dataSize(0), dataEnd(0), resumed(false), readFailed(false), chunkedRows(0), hasInvalidData(false), processed(false) {}
 
 void CsvFileHandler::readData() {
-    std::ifstream file(filePath);
+    completeTail();
+    if (options.incremental && supportsIncremental(options)) {
+        state.emplace(options);
+        if (resumeFromState()) return;
+    }
+    if (options.pipeline && supportsChunking(options) && readPipelined()) {
+        return;
+    }
+
+    std::error_code error;
+    dataSize = std::filesystem::file_size(filePath, error);
+    findFooter();
+
+    std::ifstream file(filePath, std::ios::binary);
     if (file.is_open()) {
-        std::string line;
-        while (std::getline(file, line)) {
-            if (line.empty()) continue;  // Skip empty lines
-            std::stringstream lineStream(line);
-            std::string cell;
-            std::vector<std::string> row;
-            while (std::getline(lineStream, cell, ',')) {
-                row.push_back(cell);
+        readRows(file, dataEnd);
+        file.close();
+    }
+    else {
+        setError("Unable to open file: " + filePath);
+        readFailed = true;
+    }
+}
+
+bool CsvFileHandler::readContents(std::string contents) {
+    return readBuffer(contents);
+}
+
+bool CsvFileHandler::readBuffer(std::string_view data) {
+    if (options.incremental && supportsIncremental(options)) return false;
+    // Contents read ahead of an interrupted append are finished by readData()
+    if (!filePath.empty() && std::filesystem::exists(filePath + ".state.tail")) return false;
+    dataSize = data.size();
+    dataEnd = dataSize;
+    // The contents of a file read ahead may end with the footer of an earlier run; a
+    // buffer without a file has none, so every row of it is data
+    if (!filePath.empty()) findFooter(data);
+
+    size_t headerEnd = data.find('\n');
+    if (supportsChunking(options) && headerEnd != std::string_view::npos) {
+        // The whole buffer is one chunk, merged by process()
+        appendRow(data.substr(0, headerEnd));
+        Chunk chunk;
+        chunk.begin = headerEnd + 1;
+        chunk.end = std::max<uint64_t>(dataEnd, chunk.begin);
+        parseRows(data.substr(chunk.begin, chunk.end - chunk.begin), chunk);
+        chunks.push_back(std::move(chunk));
+        return true;
+    }
+
+    // Parsed in place, without copying the contents into a string stream;
+    // the buffer is only read
+    struct ContentsBuffer : std::streambuf {
+        explicit ContentsBuffer(std::string_view text) {
+            char* begin = const_cast<char*>(text.data());
+            setg(begin, begin, begin + text.size());
+        }
+    } buffer(data);
+    std::istream stream(&buffer);
+    readRows(stream, dataEnd);
+    return true;
+}
+
+bool CsvFileHandler::readStream(std::istream& input) {
+    if (options.incremental && supportsIncremental(options)) return false;
+    readRows(input, std::numeric_limits<uint64_t>::max());
+    return true;
+}
+
+bool CsvFileHandler::reset(const std::string& filePath, const ProcessingOptions& options) {
+    std::vector<std::vector<std::string>> rows = std::move(spareRows);
+    for (auto& row : csvData) rows.push_back(std::move(row));
+    std::vector<double> buffer = std::move(values);
+
+    *this = CsvFileHandler(filePath, options);
+    spareRows = std::move(rows);
+    values = std::move(buffer);
+    values.clear();
+    return true;
+}
+
+void CsvFileHandler::appendRow(std::string_view line) {
+    if (spareRows.empty()) {
+        csvData.emplace_back();
+    }
+    else {
+        csvData.push_back(std::move(spareRows.back()));
+        spareRows.pop_back();
+    }
+    splitRow(line, delimiter, csvData.back());
+}
+
+void CsvFileHandler::readRows(std::istream& file, uint64_t end) {
+    std::string line;
+    uint64_t offset = 0;
+    while (offset < end && std::getline(file, line)) {
+        offset += line.size() + 1;
+        if (line.empty()) continue;  // Skip empty lines
+        appendRow(line);
+    }
+}
+
+void CsvFileHandler::findFooter(std::optional<std::string_view> contents) {
+    // A footer recorded by an append or incremental run is dropped only
+    // while it is still byte for byte what ends the file
+    dataEnd = dataSize;
+    StatisticsState saved;
+    if (StatisticsState::load(filePath + ".state", saved) && saved.footerSize != 0 &&
+        saved.dataEnd + saved.footerSize == dataSize) {
+        std::string tail;
+        bool read = true;
+        if (!contents) {
+            std::ifstream file(filePath, std::ios::binary);
+            tail.resize(saved.footerSize);
+            file.seekg(static_cast<std::streamoff>(saved.dataEnd));
+            read = static_cast<bool>(file.read(tail.data(), static_cast<std::streamsize>(tail.size())));
+        }
+        std::string_view footer = contents ? contents->substr(saved.dataEnd) : std::string_view(tail);
+        if (read && hash64(footer) == saved.footerHash) {
+            dataEnd = saved.dataEnd;
+            return;
+        }
+    }
+    findUnrecordedFooter(contents);
+}
+
+void CsvFileHandler::findUnrecordedFooter(std::optional<std::string_view> contents) {
+    // Rewrites keep no side file, so their footer is recognised by its rows:
+    // the file must end with one row per label these options write, in the
+    // order they are written. Rows labelled otherwise, or followed by other
+    // rows, are data.
+    std::vector<std::string> labels = footerLabels();
+    if (labels.empty() || dataSize == 0) return;
+
+    std::string block;
+    std::string_view text;
+    if (contents) {
+        text = *contents;
+    }
+    else {
+        // The last blocks of the file, until they hold the footer rows and
+        // the newline before them
+        std::ifstream file(filePath, std::ios::binary);
+        for (uint64_t size = 4096;; size *= 4) {
+            size = std::min(size, dataSize);
+            block.resize(static_cast<size_t>(size));
+            file.clear();
+            file.seekg(static_cast<std::streamoff>(dataSize - size));
+            if (!file.read(block.data(), static_cast<std::streamsize>(size))) return;
+            if (size == dataSize || static_cast<size_t>(std::count(block.begin(), block.end(), '\n')) > labels.size()) break;
+        }
+        text = block;
+    }
+    if (text.empty() || text.back() != '\n') return;
+
+    size_t footerBegin = text.size();
+    for (size_t i = labels.size(); i-- > 0;) {
+        size_t lineEnd = footerBegin - 1;
+        size_t previous = lineEnd == 0 ? std::string_view::npos : text.rfind('\n', lineEnd - 1);
+        // The header row is never part of the footer
+        if (previous == std::string_view::npos) return;
+        std::string_view line = text.substr(previous + 1, lineEnd - previous - 1);
+        const std::string& label = labels[i];
+        if (line.size() <= label.size() || line.compare(0, label.size(), label) != 0 || line[label.size()] != delimiter) {
+            return;
+        }
+        footerBegin = previous + 1;
+    }
+    dataEnd = dataSize - (text.size() - footerBegin);
+}
+
+bool CsvFileHandler::resumeFromState() {
+    StatisticsState saved;
+    if (!StatisticsState::load(filePath + ".state", saved) || saved.signature != state->signature) {
+        return false;
+    }
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(filePath, error);
+    if (error || size < saved.dataEnd + saved.footerSize) return false;
+
+    // The footer written by the previous run must still follow the data rows
+    std::ifstream file(filePath, std::ios::binary);
+    std::string footer(saved.footerSize, '\0');
+    file.seekg(static_cast<std::streamoff>(saved.dataEnd));
+    file.read(footer.data(), static_cast<std::streamsize>(footer.size()));
+    if (!file || hash64(footer) != saved.footerHash) return false;
+
+    std::string line;
+    file.seekg(0);
+    if (!std::getline(file, line)) return false;
+    appendRow(line); // Header row
+    file.seekg(static_cast<std::streamoff>(saved.dataEnd + saved.footerSize));
+    while (std::getline(file, line)) {
+        if (line.empty()) continue;  // Skip empty lines
+        appendRow(line);
+    }
+
+    *state = std::move(saved);
+    dataSize = size;
+    resumed = true;
+    return true;
+}
+
+void CsvFileHandler::writeRows(OutputBuffer& file, size_t firstRow) const {
+    for (size_t r = firstRow; r < csvData.size(); ++r) {
+        const auto& row = csvData[r];
+        if (row.empty()) continue;  // Skip empty rows
+        for (size_t i = 0; i < row.size(); ++i) {
+            file << row[i];
+            if (i < row.size() - 1) {
+                file << delimiter;
+            }
+        }
+        // Rolling window statistics are appended as derived columns
+        if (!rolling.empty()) {
+            if (r == 0) {
+                for (const char* name : {"rolling_mean", "rolling_std_dev", "rolling_min", "rolling_max"}) {
+                    file << delimiter << name;
+                }
+            }
+            else {
+                const RollingValues& window = rolling[r - 1];
+                file << delimiter << window.mean << delimiter << window.std_dev << delimiter << window.min << delimiter << window.max;
             }
-            csvData.push_back(row);
         }
+        file << "\n";
+    }
+}
+
+void CsvFileHandler::writeData() {
+    // Nothing is written for, or beside, a file that could not be read
+    if (readFailed) return;
+
+    if (options.output == OutputMode::Sidecar) {
+        writeSidecar();
+    }
+    else if (resumed) {
+        appendData();
+    }
+    else if (options.output == OutputMode::Append) {
+        appendFooter();
+    }
+    else {
+        rewriteData();
+    }
+
+    if (!hasInvalidData && !groups.empty()) {
+        writeGroups();
+    }
+    if (covariance) {
+        writeCorrelation();
+    }
+    if (!hasInvalidData && options.writeOutliers && !options.allColumns && csvData.size() > 1) {
+        writeOutliers();
+    }
+}
+
+void CsvFileHandler::rewriteData() {
+    AtomicFileWriter file(filePath);
+    if (!file.isOpen()) {
+        setError("Unable to write file: " + filePath);
+        return;
+    }
+
+    OutputBuffer out(file);
+    if (rolling.empty()) {
+        // The rows themselves are unchanged, so they are copied in-kernel
+        // instead of being formatted again cell by cell
+        file.copyFrom(filePath, dataEnd);
+        if (!endsWithNewline(filePath, dataEnd)) out << '\n';
+    }
+    else {
+        writeRows(out, 0);
+    }
+    out.flush();
+    uint64_t rowsEnd = static_cast<uint64_t>(file.tellp());
+
+    // Only write statistics if there is no invalid data and valid data was processed
+    OutputBuffer footer;
+    if (!hasInvalidData && hasRows()) {
+        writeStatisticsFooter(footer);
+        out << footer.view();
+    }
+    out.flush();
+    if (!file.commit()) {
+        setError("Unable to write file: " + filePath);
+        return;
+    }
+    finalSize = rowsEnd + footer.view().size();
+    // Only incremental runs keep a state file; the next full run finds the
+    // footer by its labels
+    writeState(state && !footer.view().empty() ? stateAfter(rowsEnd, footer.view()) : "");
+}
+
+nlohmann::json CsvFileHandler::statisticsJson() const {
+    nlohmann::json statsEntry = nlohmann::json::object();
+    if (options.allColumns) {
+        if (columnStats.empty()) return statsEntry;
+        for (const auto& entry : columnStats) {
+            statsEntry[entry.name] = statisticsEntry(entry.stats, options);
+        }
+    }
+    else {
+        statsEntry = statisticsEntry(stats, options);
+    }
+    addIdStatistics(statsEntry, idSketch, topIds, options, false);
+    return statsEntry;
+}
+
+std::string CsvFileHandler::summary() const {
+    if (hasInvalidData || !processed) return "";
+    return statisticsJson().dump();
+}
+
+void CsvFileHandler::writeSidecar() {
+    finalSize = dataSize;
+    if (hasInvalidData || (!hasRows() && !resumed)) {
+        if (state) discardState();
+        return;
+    }
+
+    nlohmann::json statsEntry = statisticsJson();
+    if (statsEntry.empty()) return;
+
+    // Nothing follows the data rows, so a later incremental run resumes at
+    // the size the file had when it was read
+    if (!writeStatisticsSidecar(filePath, statsEntry)) {
+        setError("Unable to write file: " + filePath + ".stats.json");
+    }
+    else if (state) {
+        writeState(stateAfter(dataSize, ""));
+    }
+}
+
+void CsvFileHandler::appendFooter() {
+    // Without new statistics the footer of an earlier run stays as it is
+    if (hasInvalidData || !hasRows()) return;
+    OutputBuffer footer;
+    writeStatisticsFooter(footer);
+
+    // The previous footer, if any, is replaced; the rows themselves are never
+    // written, but must end with a newline before the footer can follow them
+    OutputBuffer tail;
+    if (!endsWithNewline(filePath, dataEnd)) tail << '\n';
+    uint64_t rowsEnd = dataEnd + tail.view().size();
+    tail << footer.view();
+    replaceTail(dataEnd, tail.view(), footer.view().empty() ? "" : stateAfter(rowsEnd, footer.view()));
+}
+
+void CsvFileHandler::appendData() {
+    // The appended rows move up over the previous footer; old rows stay untouched
+    OutputBuffer tail;
+    writeRows(tail, 1);
+    uint64_t rowsEnd = state->dataEnd + tail.view().size();
+    OutputBuffer footer;
+    if (!hasInvalidData) {
+        writeStatisticsFooter(footer);
+        tail << footer.view();
+    }
+
+    // With invalid rows they are kept, but the next run has to start over
+    replaceTail(state->dataEnd, tail.view(), hasInvalidData ? "" : stateAfter(rowsEnd, footer.view()));
+}
+
+std::string CsvFileHandler::stateAfter(uint64_t dataEnd, std::string_view footer) const {
+    if (!state && footer.empty()) return "";
+
+    // A full run only records where its footer is; it never matches the
+    // options of an incremental run
+    StatisticsState record = state ? *state : StatisticsState();
+    if (!state) record.signature = footerSignature;
+    record.dataEnd = dataEnd;
+    record.footerSize = footer.size();
+    record.footerHash = hash64(footer);
+    return record.serialize();
+}
+
+void CsvFileHandler::writeState(std::string_view text) {
+    if (text.empty()) {
+        discardState();
+        return;
+    }
+    AtomicFileWriter file(filePath + ".state");
+    file << text;
+    if (!file.commit()) {
+        setError("Unable to write state file: " + filePath + ".state");
+    }
+}
+
+void CsvFileHandler::replaceTail(uint64_t offset, std::string_view tail, std::string_view stateText) {
+    // A journal for a file that cannot be written would be retried forever
+    if (!std::fstream(filePath, std::ios::in | std::ios::out | std::ios::binary).is_open()) {
+        setError("Unable to write file: " + filePath);
+        return;
+    }
+
+    // Journal first: "<offset> <tail size>", the tail, then the state. Moving
+    // rows in place is not atomic, so a run interrupted part way leaves the
+    // journal for the next one to finish
+    std::string journalPath = filePath + ".state.tail";
+    AtomicFileWriter journal(journalPath);
+    journal << offset << ' ' << tail.size() << '\n' << tail << stateText;
+    if (!journal.commit()) {
+        setError("Unable to write file: " + journalPath);
+        return;
+    }
+    if (applyTail(offset, tail, stateText)) finalSize = offset + tail.size();
+}
+
+bool CsvFileHandler::applyTail(uint64_t offset, std::string_view tail, std::string_view stateText) {
+    if (!replaceFileTail(filePath, offset, tail)) {
+        setError("Unable to write file: " + filePath);
+        return false;
+    }
+    writeState(stateText);
+    std::remove((filePath + ".state.tail").c_str());
+    return true;
+}
+
+void CsvFileHandler::completeTail() {
+    std::ifstream journal(filePath + ".state.tail", std::ios::binary);
+    if (!journal.is_open()) return;
+
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    std::string tail;
+    if (journal >> offset >> size && journal.get() == '\n') {
+        tail.resize(size);
+        journal.read(tail.data(), static_cast<std::streamsize>(size));
+    }
+    if (!journal || tail.size() != size) {
+        // Journals are committed whole, so this one was not written by us
+        setError("Ignoring unreadable file: " + filePath + ".state.tail");
+        std::remove((filePath + ".state.tail").c_str());
+        return;
+    }
+    std::string stateText((std::istreambuf_iterator<char>(journal)), std::istreambuf_iterator<char>());
+    journal.close();
+    applyTail(offset, tail, stateText);
+}
+
+void CsvFileHandler::discardState() const {
+    std::remove((filePath + ".state").c_str());
+}
+
+std::vector<std::string> CsvFileHandler::footerLabels() const {
+    std::vector<std::string> labels;
+    if (options.statistics & StatMean) labels.push_back("mean");
+    if (options.statistics & StatMedian) labels.push_back("median");
+    if (options.statistics & StatStdDev) labels.push_back("std_dev");
+    for (double percentile : options.percentiles) labels.push_back(percentileLabel(percentile));
+    if (options.robustStatistics()) {
+        labels.insert(labels.end(), {"mad", "z_outliers", "mad_outliers"});
+    }
+    if (options.histogramDigits > 0) labels.push_back("histogram");
+    if (options.distinctIds) labels.push_back("distinct_ids");
+    if (options.topK > 0) labels.push_back("top_ids");
+    return labels;
+}
+
+void CsvFileHandler::writeStatisticsFooter(OutputBuffer& file) const {
+    std::vector<ColumnStatistics> columns = columnStats;
+    if (!options.allColumns) {
+        columns = { ColumnStatistics{1, "", stats} };
+    }
+    if (columns.empty()) return;
+
+    // One row per statistic, each column's value placed under its header cell
+    auto writeRow = [&](const std::string& label, auto writeCell) {
+        file << label;
+        size_t column = 0;
+        for (const auto& entry : columns) {
+            for (; column < entry.column; ++column) {
+                file << delimiter;
+            }
+            writeCell(entry.stats);
+        }
+        file << "\n";
+    };
+
+    if (options.statistics & StatMean) {
+        writeRow("mean", [&](const Statistics& s) { file << s.mean; });
+    }
+    if (options.statistics & StatMedian) {
+        writeRow("median", [&](const Statistics& s) { file << s.median; });
+    }
+    if (options.statistics & StatStdDev) {
+        writeRow("std_dev", [&](const Statistics& s) { file << s.std_dev; });
+    }
+    for (size_t i = 0; i < options.percentiles.size(); ++i) {
+        writeRow(percentileLabel(options.percentiles[i]), [&](const Statistics& s) { file << s.percentileValues[i]; });
+    }
+    if (options.robustStatistics()) {
+        writeRow("mad", [&](const Statistics& s) { file << s.mad; });
+        writeRow("z_outliers", [&](const Statistics& s) { file << s.zScoreOutliers; });
+        writeRow("mad_outliers", [&](const Statistics& s) { file << s.madOutliers; });
+    }
+    if (options.histogramDigits > 0) {
+        writeRow("histogram", [&](const Statistics& s) { file << s.histogram->serialize(); });
+    }
+    if (idSketch) {
+        file << "distinct_ids" << delimiter << idSketch->estimate() << "\n";
+    }
+    if (topIds) {
+        // id:count pairs, most frequent first
+        file << "top_ids" << delimiter;
+        std::vector<SpaceSaving::Counter> top = topIds->top(options.topK);
+        for (size_t i = 0; i < top.size(); ++i) {
+            file << (i ? ";" : "") << top[i].key << ":" << top[i].count;
+        }
+        file << "\n";
+    }
+}
+
+void CsvFileHandler::writeGroups() {
+    std::string groupsPath = filePath + ".groups.csv";
+    std::ofstream file(groupsPath);
+    if (file.is_open()) {
+        OutputBuffer out(file);
+        out << (csvData.front().empty() ? "id" : csvData.front()[0]) << ",count,mean,min,max\n";
+        for (const auto& [id, group] : groups) {
+            out << id << ',' << group.count << ',' << group.mean() << ',' << group.min << ',' << group.max << '\n';
+        }
+        out.flush();
         file.close();
     }
     else {
-        std::cerr << "Unable to open file: " << filePath << std::endl;
+        setError("Unable to open file: " + groupsPath);
     }
 }
 
-void CsvFileHandler::writeData() {
-    std::ofstream file(filePath);
+void CsvFileHandler::writeOutliers() {
+    std::string outliersPath = filePath + ".outliers.csv";
+    std::ofstream file(outliersPath);
     if (file.is_open()) {
-        for (const auto& row : csvData) {
-            if (row.empty()) continue;  // Skip empty rows
-            for (size_t i = 0; i < row.size(); ++i) {
-                file << row[i];
-                if (i < row.size() - 1) {
-                    file << ",";
+        // Rows are 0-based data rows, not counting the header
+        OutputBuffer out(file);
+        out << "row," << (csvData.front().empty() ? "id" : csvData.front()[0]) << ",value\n";
+        for (const Outlier& outlier : stats.outliers) {
+            out << outlier.row << ',' << csvData[outlier.row + 1][0] << ',' << outlier.value << '\n';
+        }
+        out.flush();
+        file.close();
+    }
+    else {
+        setError("Unable to open file: " + outliersPath);
+    }
+}
+
+void CsvFileHandler::writeCorrelation() {
+    // Square matrix with the column names along both axes
+    auto writeMatrix = [this](const std::string& matrixPath, const std::string& corner, auto cellValue) {
+        std::ofstream file(matrixPath);
+        if (!file.is_open()) {
+            setError("Unable to open file: " + matrixPath);
+            return;
+        }
+        OutputBuffer out(file);
+        out << corner;
+        for (const auto& name : correlationColumns) {
+            out << ',' << name;
+        }
+        out << '\n';
+        for (size_t i = 0; i < correlationColumns.size(); ++i) {
+            out << correlationColumns[i];
+            for (size_t j = 0; j < correlationColumns.size(); ++j) {
+                out << ',' << cellValue(i, j);
+            }
+            out << '\n';
+        }
+        out.flush();
+        file.close();
+    };
+
+    writeMatrix(filePath + ".covariance.csv", "covariance", [this](size_t i, size_t j) { return covariance->covariance(i, j); });
+    writeMatrix(filePath + ".correlation.csv", "correlation", [this](size_t i, size_t j) { return covariance->correlation(i, j); });
+}
+
+size_t CsvFileHandler::prepareChunks(uint64_t chunkSize) {
+    if (chunkSize == 0 || !supportsChunking(options)) return 0;
+    completeTail();
+    std::error_code error;
+    dataSize = std::filesystem::file_size(filePath, error);
+    if (error || dataSize <= chunkSize) return 0;
+
+    std::ifstream file(filePath, std::ios::binary);
+    std::string header;
+    if (!file.is_open() || !std::getline(file, header) || header.empty()) return 0;
+    uint64_t rowsBegin = header.size() + 1;
+    findFooter();
+    if (dataEnd <= rowsBegin) return 0;
+
+    // Every chunk but the last ends just after the first newline at or past
+    // its nominal end, so no row is split between two chunks
+    uint64_t begin = rowsBegin;
+    std::string block(4096, '\0');
+    while (begin < dataEnd) {
+        uint64_t end = std::min(dataEnd, begin + chunkSize);
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(end - 1));
+        while (end < dataEnd) {
+            file.read(block.data(), static_cast<std::streamsize>(block.size()));
+            size_t length = static_cast<size_t>(file.gcount());
+            size_t newline = block.find('\n');
+            if (newline < length) {
+                end = std::min(dataEnd, end + newline);
+                break;
+            }
+            if (length == 0) {
+                end = dataEnd;
+                break;
+            }
+            end += length;
+        }
+        Chunk chunk;
+        chunk.begin = begin;
+        chunk.end = end;
+        chunks.push_back(std::move(chunk));
+        begin = end;
+    }
+
+    appendRow(header);
+    return chunks.size();
+}
+
+void CsvFileHandler::parseChunk(size_t index) {
+    Chunk& chunk = chunks[index];
+    std::string text(chunk.end - chunk.begin, '\0');
+    std::ifstream file(filePath, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(chunk.begin));
+    if (!file.read(text.data(), static_cast<std::streamsize>(text.size()))) {
+        chunk.error = "Unable to read file: " + filePath;
+        return;
+    }
+    parseRows(text, chunk);
+}
+
+void CsvFileHandler::parseRows(std::string_view text, Chunk& chunk) const {
+    if (options.distinctIds) chunk.ids.emplace();
+
+    // Same row rules as process(): the value is the second cell, and a row
+    // without one (a trailing comma does not start a cell) is invalid
+    chunk.values.reserve(chunk.values.size() + text.size() / 16);
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t stop = text.find('\n', start);
+        if (stop == std::string_view::npos) stop = text.size();
+        std::string_view line = text.substr(start, stop - start);
+        start = stop + 1;
+        if (line.empty()) continue;
+
+        size_t comma = line.find(delimiter);
+        if (comma == std::string_view::npos || comma + 1 == line.size()) {
+            chunk.error = "Invalid row format in CSV file.";
+            return;
+        }
+        std::string_view id = line.substr(0, comma);
+        std::string value(line.substr(comma + 1, line.find(delimiter, comma + 1) - comma - 1));
+        try {
+            chunk.values.push_back(std::stod(value));
+        }
+        catch (const std::invalid_argument& e) {
+            chunk.error = "Invalid value in CSV file: " + value;
+            return;
+        }
+        catch (const std::out_of_range& e) {
+            chunk.error = "Value out of range in CSV file: " + value;
+            return;
+        }
+        if (chunk.ids) chunk.ids->add(id);
+    }
+}
+
+bool CsvFileHandler::readPipelined() {
+    std::error_code error;
+    dataSize = std::filesystem::file_size(filePath, error);
+    std::ifstream file(filePath, std::ios::binary);
+    std::string header;
+    if (error || !file.is_open() || !std::getline(file, header) || header.empty()) return false;
+    uint64_t rowsBegin = header.size() + 1;
+    findFooter();
+    appendRow(header);
+
+    // Buffers circulate between the reader and the parser, so no block is
+    // allocated after the first pipelineDepth ones
+    BoundedQueue<std::string> freeBuffers(pipelineDepth);
+    BoundedQueue<std::string> filled(pipelineDepth);
+    BoundedQueue<Chunk> parsed(pipelineDepth);
+    for (size_t i = 0; i < pipelineDepth; ++i) freeBuffers.push(std::string());
+    std::atomic<bool> stop(false);
+
+    // Reader: blocks of complete rows; a row cut by the end of a block is
+    // carried over to the next one. A row longer than a block grows the
+    // buffer it started in, so only the parser returns buffers to
+    // freeBuffers, as a single-producer queue requires.
+    std::thread reader([&]() {
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(rowsBegin));
+        uint64_t remaining = dataEnd > rowsBegin ? dataEnd - rowsBegin : 0;
+        std::string carry;
+        std::string buffer;
+        while ((remaining > 0 || !carry.empty()) && !stop && freeBuffers.pop(buffer)) {
+            buffer.assign(carry);
+            carry.clear();
+            while (remaining > 0 && !stop) {
+                size_t offset = buffer.size();
+                size_t wanted = static_cast<size_t>(std::min<uint64_t>(remaining, pipelineBlockSize));
+                buffer.resize(offset + wanted);
+                file.read(buffer.data() + offset, static_cast<std::streamsize>(wanted));
+                size_t length = static_cast<size_t>(file.gcount());
+                buffer.resize(offset + length);
+                remaining = length < wanted ? 0 : remaining - length;
+
+                // The bytes before offset hold no newline, so only the new
+                // ones are searched
+                if (remaining > 0 && buffer.find('\n', offset) != std::string::npos) {
+                    size_t newline = buffer.rfind('\n');
+                    carry.assign(buffer, newline + 1);
+                    buffer.resize(newline + 1);
+                    break;
                 }
             }
-            file << "\n";
+            filled.push(std::move(buffer));
         }
-        // Only write statistics if there is no invalid data and valid data was processed
-        if (!hasInvalidData && csvData.size() > 1) {
-            file << "mean," << mean << "\n";
-            file << "median," << median << "\n";
-            file << "std_dev," << std_dev << "\n";
+        filled.close();
+    });
+
+    // Parser: rows to values and id sketch, returning the buffer for reuse
+    std::thread parser([&]() {
+        std::string buffer;
+        while (filled.pop(buffer)) {
+            Chunk batch;
+            if (!stop) parseRows(buffer, batch);
+            freeBuffers.push(std::move(buffer));
+            parsed.push(std::move(batch));
         }
-        //file.flush();
-        file.close();
+        parsed.close();
+    });
+
+    // Aggregation on this thread, in file order
+    Chunk total;
+    if (options.distinctIds) total.ids.emplace();
+    Chunk batch;
+    while (parsed.pop(batch)) {
+        if (!total.error.empty()) continue;
+        if (!batch.error.empty()) {
+            total.error = std::move(batch.error);
+            stop = true;
+            continue;
+        }
+        total.values.insert(total.values.end(), batch.values.begin(), batch.values.end());
+        if (total.ids && batch.ids) total.ids->merge(*batch.ids);
     }
-    else {
-        std::cerr << "Unable to open file: " << filePath << std::endl;
+    reader.join();
+    parser.join();
+
+    chunks.clear();
+    chunks.push_back(std::move(total));
+    return true;
+}
+
+void CsvFileHandler::mergeChunks() {
+    size_t total = 0;
+    for (const auto& chunk : chunks) {
+        if (!chunk.error.empty()) {
+            setError(chunk.error);
+            hasInvalidData = true;
+            chunks.clear();
+            return;
+        }
+        total += chunk.values.size();
     }
+
+    // Values are concatenated in file order, so the statistics are exactly
+    // those of a whole-file run. Reserved pages are only touched as values
+    // are appended, and each chunk is freed right after, so the parsed
+    // values are held about once rather than twice.
+    values.clear();
+    values.reserve(total);
+    if (options.distinctIds) idSketch.emplace();
+    for (auto& chunk : chunks) {
+        values.insert(values.end(), chunk.values.begin(), chunk.values.end());
+        std::vector<double>().swap(chunk.values);
+        if (idSketch && chunk.ids) idSketch->merge(*chunk.ids);
+    }
+    chunks.clear();
+
+    chunkedRows = values.size();
+    if (values.empty()) {
+        setError("CSV data is empty or only contains header row.");
+        return;
+    }
+    stats = calculateStatistics(values, options);
+    processed = true;
 }
 
 void CsvFileHandler::process() {
-    if (csvData.size() <= 1) {
-        std::cerr << "CSV data is empty or only contains header row.\n";
+    if (!chunks.empty()) {
+        // Already parsed by readPipelined()
+        mergeChunks();
+        return;
+    }
+    if (csvData.size() <= 1 && !resumed) {
+        setError("CSV data is empty or only contains header row.");
         return;
     }
 
-    std::vector<double> values;
+    if (state) {
+        // Incremental runs continue the sketch of the rows processed before
+        idSketch = state->idSketch;
+    }
+    else if (options.distinctIds) {
+        idSketch.emplace();
+    }
+    if (options.topK > 0) {
+        topIds.emplace(options.heavyHitterCapacity());
+    }
+
+    if (options.correlation) {
+        processCorrelation();
+    }
+
+    if (options.allColumns) {
+        processAllColumns();
+        return;
+    }
+
+    values.clear();
+    std::vector<std::string_view> ids;
     for (size_t i = 1; i < csvData.size(); ++i) { // Skip header row
         if (csvData[i].size() < 2) {
-            std::cerr << "Invalid row format in CSV file.\n";
+            setError("Invalid row format in CSV file.");
             hasInvalidData = true;
             return;
         }
         try {
             values.push_back(std::stod(csvData[i][1]));
+            if (options.groupBy) ids.push_back(csvData[i][0]);
+            sketchId(csvData[i][0]);
         }
         catch (const std::invalid_argument& e) {
-            std::cerr << "Invalid value in CSV file: " << csvData[i][1] << "\n";
+            setError("Invalid value in CSV file: " + csvData[i][1]);
+            hasInvalidData = true;
+            return;
+        }
+        catch (const std::out_of_range& e) {
+            setError("Value out of range in CSV file: " + csvData[i][1]);
             hasInvalidData = true;
             return;
         }
     }
 
+    if (state) {
+        processIncremental(values);
+        return;
+    }
+
     if (values.empty()) {
-        std::cerr << "No valid data to process.\n";
+        setError("No valid data to process.");
         return;
     }
 
-    calculateStatistics(values);
+    stats = calculateStatistics(values, options);
+    processed = true;
+
+    if (options.rollingWindow > 0) {
+        rolling = calculateRollingStatistics(values, options.rollingWindow);
+    }
+
+    if (options.groupBy) {
+        groups = sortedGroups(aggregateGroups(ids, values, options.threadCount()));
+    }
+}
+
+void CsvFileHandler::processIncremental(const std::vector<double>& values) {
+    state->add(values);
+    state->idSketch = idSketch;
+    stats = state->statistics();
+    processed = state->count > 0;
 }
 
-void CsvFileHandler::calculateStatistics(const std::vector<double>& values) {
-    if (values.empty()) return;
+void CsvFileHandler::processAllColumns() {
+    size_t width = 0;
+    for (size_t i = 0; i < csvData.size(); ++i) {
+        width = std::max(width, csvData[i].size());
+        if (i > 0 && !csvData[i].empty()) sketchId(csvData[i][0]);
+    }
 
-    // Calculate mean
-    double sum = std::accumulate(values.begin(), values.end(), 0.0);
-    mean = sum / values.size();
+    // Every column but the id column is a candidate. Each worker parses and
+    // summarises whole columns; missing or empty cells are skipped, a single
+    // non-numeric cell drops the column.
+    std::vector<std::optional<ColumnStatistics>> results(width);
+    parallelFor(width > 1 ? width - 1 : 0, options.threadCount(), [&](size_t task) {
+        size_t column = task + 1;
+        std::vector<double> values;
+        for (size_t i = 1; i < csvData.size(); ++i) {
+            if (csvData[i].size() <= column || csvData[i][column].empty()) continue;
+            try {
+                values.push_back(std::stod(csvData[i][column]));
+            }
+            catch (const std::exception&) {
+                return;
+            }
+        }
+        if (values.empty()) return;
 
-    // Sort values to calculate median
-    std::vector<double> sorted_values = values;
-    std::sort(sorted_values.begin(), sorted_values.end());
+        const auto& header = csvData.front();
+        std::string name = column < header.size() ? header[column] : "";
+        results[column] = ColumnStatistics{column, name, calculateStatistics(values, options)};
+    });
 
-    // Calculate median
-    if (sorted_values.size() % 2 == 0) {
-        median = (sorted_values[sorted_values.size() / 2 - 1] + sorted_values[sorted_values.size() / 2]) / 2;
+    for (auto& result : results) {
+        if (result) columnStats.push_back(std::move(*result));
     }
-    else {
-        median = sorted_values[sorted_values.size() / 2];
+    if (columnStats.empty()) {
+        setError("No numeric columns to process.");
+        return;
     }
+    processed = true;
+}
+
+void CsvFileHandler::processCorrelation() {
+    // Parse the candidate columns into columnar arrays, one column per task.
+    // Only columns with a numeric value in every row take part.
+    const auto& header = csvData.front();
+    size_t width = header.size();
+    std::vector<std::vector<double>> parsed(width);
+    std::vector<char> dense(width, 0);
+    parallelFor(width > 1 ? width - 1 : 0, options.threadCount(), [&](size_t task) {
+        size_t column = task + 1;
+        std::vector<double> values;
+        for (size_t i = 1; i < csvData.size(); ++i) {
+            if (csvData[i].size() <= column) return;
+            try {
+                values.push_back(std::stod(csvData[i][column]));
+            }
+            catch (const std::exception&) {
+                return;
+            }
+        }
+        parsed[column] = std::move(values);
+        dense[column] = 1;
+    });
+
+    std::vector<std::vector<double>> columns;
+    for (size_t column = 0; column < width; ++column) {
+        if (!dense[column]) continue;
+        correlationColumns.push_back(header[column]);
+        columns.push_back(std::move(parsed[column]));
+    }
+    if (columns.size() < 2) {
+        setError("Correlation needs at least two numeric columns.");
+        correlationColumns.clear();
+        return;
+    }
+
+    covariance = calculateCovariance(columns, options.threadCount());
+}
 
-    // Calculate standard deviation
-    double sq_sum = std::inner_product(values.begin(), values.end(), values.begin(), 0.0);
-    std_dev = std::sqrt(sq_sum / values.size() - mean * mean);
+void CsvFileHandler::sketchId(std::string_view id) {
+    if (idSketch) idSketch->add(id);
+    if (topIds) topIds->add(id);
 }
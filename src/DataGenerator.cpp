@@ -0,0 +1,172 @@
+#include "DataGenerator.hpp"
+#include "AtomicFileWriter.hpp"
+#include "Hash.hpp"
+#include "OutputBuffer.hpp"
+#include "Parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Chunks generated per round before they are written, per thread
+const size_t chunksPerThread = 2;
+
+// log1p(x) / x, accurate near 0
+double helper1(double x) {
+    return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+}
+
+// expm1(x) / x, accurate near 0
+double helper2(double x) {
+    return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+}
+
+uint64_t splitMix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// The random stream of one chunk. std::mt19937_64 produces the same
+// sequence everywhere; the conversions to doubles and ranges are done here
+class ChunkRandom {
+public:
+    ChunkRandom(uint64_t seed, uint64_t chunk) : engine(splitMix64(seed ^ splitMix64(chunk))) {}
+
+    // In [0, 1)
+    double operator()() { return static_cast<double>(engine() >> 11) * 0x1.0p-53; }
+
+    // In [1, count]
+    uint64_t rank(uint64_t count) {
+        uint64_t high;
+        multiply128(engine(), count, high);
+        return high + 1;
+    }
+
+    // Standard normal, by the Box-Muller transform
+    double normal() {
+        if (hasSpare) {
+            hasSpare = false;
+            return spare;
+        }
+        double radius = std::sqrt(-2 * std::log(1 - (*this)()));
+        double angle = 2 * std::numbers::pi * (*this)();
+        spare = radius * std::sin(angle);
+        hasSpare = true;
+        return radius * std::cos(angle);
+    }
+
+private:
+    std::mt19937_64 engine;
+    double spare = 0;
+    bool hasSpare = false;
+};
+
+// Text of the rows [first, first + count) of the file
+std::string generateChunk(const GeneratorOptions& options, const ZipfSampler* zipf, uint64_t chunk, uint64_t first, uint64_t count) {
+    ChunkRandom random(options.seed, chunk);
+    OutputBuffer out;
+    bool json = options.format == FileFormat::Json;
+    bool ndjson = options.format == FileFormat::Ndjson;
+    for (uint64_t row = first; row < first + count; ++row) {
+        uint64_t id = zipf ? (*zipf)(random) : random.rank(options.idCount);
+        double value = options.values == ValueDistribution::Normal
+            ? options.mean + options.stdDev * random.normal()
+            : options.minValue + (options.maxValue - options.minValue) * random();
+        double fault = random();
+        bool nan = fault < options.nanRate;
+        bool bad = !nan && fault < options.nanRate + options.badRate;
+
+        if (json) {
+            out << std::string_view(row ? ",\n" : "\n") << std::string_view("    {\n        \"id\": ") << id
+                << std::string_view(",\n        \"value\": ");
+        }
+        else if (ndjson) {
+            out << std::string_view("{\"id\":") << id << std::string_view(",\"value\":");
+        }
+        else {
+            out << id << options.delimiter;
+        }
+
+        if (bad) out << std::string_view(json || ndjson ? "\"n/a\"" : "n/a");
+        else if (nan && (json || ndjson)) out << std::string_view("null");
+        else out << (nan ? std::numeric_limits<double>::quiet_NaN() : value);
+
+        if (json) out << std::string_view("\n    }");
+        else if (ndjson) out << std::string_view("}\n");
+        else out << '\n';
+    }
+    return std::string(out.view());
+}
+
+} // namespace
+
+ZipfSampler::ZipfSampler(uint64_t count, double exponent) : count(std::max<uint64_t>(count, 1)), exponent(exponent) {
+    hIntegralFirst = hIntegral(1.5) - 1;
+    hIntegralCount = hIntegral(static_cast<double>(this->count) + 0.5);
+    squeeze = 2 - hIntegralInverse(hIntegral(2.5) - h(2));
+}
+
+double ZipfSampler::h(double x) const {
+    return std::exp(-exponent * std::log(x));
+}
+
+double ZipfSampler::hIntegral(double x) const {
+    double logX = std::log(x);
+    return helper2((1 - exponent) * logX) * logX;
+}
+
+double ZipfSampler::hIntegralInverse(double x) const {
+    double t = std::max(x * (1 - exponent), -1.0);
+    return std::exp(helper1(t) * x);
+}
+
+bool generateDataFile(const std::string& path, const GeneratorOptions& options, std::string* error) {
+    AtomicFileWriter file(path, size_t(4) << 20);
+    if (!file.isOpen()) {
+        if (error) *error = "Unable to open file: " + path;
+        return false;
+    }
+
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    uint64_t chunkRows = std::max<uint64_t>(options.chunkRows, 1);
+    uint64_t chunks = (options.rows + chunkRows - 1) / chunkRows;
+    ZipfSampler zipf(options.idCount, options.zipfExponent);
+    const ZipfSampler* ids = options.ids == IdDistribution::Zipf ? &zipf : nullptr;
+
+    if (options.format == FileFormat::Json) {
+        file << '[';
+    }
+    else if (options.format == FileFormat::Csv) {
+        file << "id" << options.delimiter << "value\n";
+    }
+
+    // Rounds of chunks are generated in parallel, then written in order
+    std::vector<std::string> texts(std::min<uint64_t>(chunks, threads * chunksPerThread));
+    for (uint64_t round = 0; round < chunks; round += texts.size()) {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(texts.size(), chunks - round));
+        parallelFor(count, threads, [&](size_t i) {
+            uint64_t chunk = round + i;
+            uint64_t first = chunk * chunkRows;
+            texts[i] = generateChunk(options, ids, chunk, first, std::min(chunkRows, options.rows - first));
+        });
+        for (size_t i = 0; i < count; ++i) {
+            file.write(texts[i].data(), static_cast<std::streamsize>(texts[i].size()));
+        }
+    }
+
+    if (options.format == FileFormat::Json) {
+        file << (options.rows > 0 ? "\n]" : "]");
+    }
+    if (!file.commit()) {
+        if (error) *error = "Unable to write file: " + path;
+        return false;
+    }
+    return true;
+}
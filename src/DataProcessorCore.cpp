@@ -0,0 +1,79 @@
+#include "DataProcessorCore.hpp"
+#include "BatchProcessor.hpp"
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <string_view>
+
+namespace {
+
+// Name given to the handlers in place of a file path; never opened
+const char* bufferName = "";
+
+// Options of an in-memory run: nothing is read from or written to a file
+ProcessingOptions bufferOptions(const ProcessingOptions& options) {
+    ProcessingOptions result = options;
+    result.incremental = false;
+    result.pipeline = false;
+    return result;
+}
+
+// Creates the handler for format, reads the data with read and processes it
+template <typename Read>
+StatisticsResult process(const SniffResult& sniffed, const ProcessingOptions& options, Read read) {
+    StatisticsResult result;
+    result.format = sniffed.format;
+    if (sniffed.format == FileFormat::Unknown || sniffed.format == FileFormat::Compressed) {
+        result.error = sniffed.format == FileFormat::Unknown ? "unrecognised data format"
+                                                             : "compressed (" + sniffed.compression + ") data is not supported";
+        return result;
+    }
+
+    try {
+        std::unique_ptr<FileHandlerCreator> creator = createFileHandlerCreator(bufferName, sniffed, bufferOptions(options));
+        std::unique_ptr<FileHandler> handler = creator ? creator->createFileHandler(bufferName) : nullptr;
+        if (!handler) {
+            result.error = "unsupported data format";
+            return result;
+        }
+        if (!read(*handler)) {
+            result.error = handler->errorMessage().empty() ? "the handler cannot read data from memory" : handler->errorMessage();
+            return result;
+        }
+        handler->process();
+        if (!handler->succeeded()) {
+            result.error = handler->errorMessage().empty() ? "no statistics computed" : handler->errorMessage();
+            return result;
+        }
+        result.succeeded = true;
+        if (const Statistics* values = handler->valueStatistics()) result.values = *values;
+        result.json = handler->summary();
+    }
+    catch (const std::exception& e) {
+        result.error = e.what();
+    }
+    return result;
+}
+
+} // namespace
+
+StatisticsResult processBuffer(std::span<const char> data, const ProcessingOptions& options) {
+    std::string_view text(data.data(), data.size());
+    return process(sniffContents(text.substr(0, sniffLength)), options, [text](FileHandler& handler) {
+        return handler.readBuffer(text);
+    });
+}
+
+StatisticsResult processStream(std::istream& input, FileFormat format, const ProcessingOptions& options) {
+    if (format == FileFormat::Unknown) {
+        std::string contents(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>{});
+        return processBuffer(contents, options);
+    }
+
+    SniffResult sniffed;
+    sniffed.format = format;
+    sniffed.delimiter = options.delimiter ? options.delimiter : ',';
+    return process(sniffed, options, [&input](FileHandler& handler) {
+        return handler.readStream(input);
+    });
+}
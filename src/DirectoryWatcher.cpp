@@ -0,0 +1,213 @@
+#include "DirectoryWatcher.hpp"
+#include "BatchProcessor.hpp"
+#include "PathPattern.hpp"
+#include <algorithm>
+#include <filesystem>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <thread>
+#endif
+
+#ifdef __linux__
+
+namespace {
+
+// A writer closing the file, a file renamed into place (as by the atomic
+// rewrites) and in-place appends by writers that keep the file open
+const uint32_t fileEvents = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MODIFY | IN_CREATE;
+
+std::string joinPath(const std::string& directory, const std::string& name) {
+    if (directory.empty()) return name;
+    return directory.back() == '/' ? directory + name : directory + "/" + name;
+}
+
+} // namespace
+
+DirectoryWatcher::DirectoryWatcher(const std::vector<std::string>& inputs)
+    : inputs(inputs), fd(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+    if (fd < 0) {
+        errors.push_back("Unable to initialise inotify.");
+        return;
+    }
+
+    for (const auto& input : inputs) {
+        std::error_code error;
+        if (!hasWildcards(input) && std::filesystem::is_directory(input, error)) {
+            watch(input, true);
+            continue;
+        }
+
+        // Single files and patterns are matched in their directories
+        patterns.push_back(input);
+        size_t slash = input.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "" : input.substr(0, slash == 0 ? 1 : slash);
+        if (!hasWildcards(directory)) {
+            watch(directory, false);
+            continue;
+        }
+        for (const auto& match : expandPattern(directory, true)) {
+            watch(match, false);
+        }
+    }
+}
+
+DirectoryWatcher::~DirectoryWatcher() {
+    if (fd >= 0) ::close(fd);
+}
+
+void DirectoryWatcher::watch(const std::string& directory, bool recursive) {
+    std::string path = directory.empty() ? "." : directory;
+    int descriptor = ::inotify_add_watch(fd, path.c_str(), fileEvents | IN_ONLYDIR);
+    if (descriptor < 0) {
+        errors.push_back("Unable to watch directory: " + path);
+        return;
+    }
+    // A directory watched as a tree and for a pattern reports its whole tree
+    Watch& entry = directories[descriptor];
+    entry.directory = directory;
+    entry.recursive = entry.recursive || recursive;
+    if (!recursive) return;
+
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(path, error), end; !error && it != end; it.increment(error)) {
+        if (it->is_directory(error) && !it->is_symlink(error)) watch(it->path().string(), true);
+    }
+}
+
+bool DirectoryWatcher::accepts(const std::string& path, bool recursive) const {
+    if (!isBatchInput(path)) return false;
+    if (recursive) return true;
+    return std::any_of(patterns.begin(), patterns.end(), [&path](const std::string& pattern) {
+        return matchesPattern(pattern, path);
+    });
+}
+
+bool DirectoryWatcher::readEvents(std::vector<std::string>& changed) {
+    alignas(inotify_event) char buffer[64 * 1024];
+    bool any = false;
+    while (true) {
+        ssize_t length = ::read(fd, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR) continue;
+        if (length <= 0) return any;
+
+        for (char* next = buffer; next < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(next);
+            next += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost: rescan the inputs, watching the
+                // directories created meanwhile as well
+                std::vector<std::string> roots;
+                for (const auto& [descriptor, entry] : directories) {
+                    if (entry.recursive) roots.push_back(entry.directory);
+                }
+                for (const auto& root : roots) watch(root, true);
+                for (auto& path : expandInputs(inputs)) changed.push_back(std::move(path));
+                any = true;
+                continue;
+            }
+            auto watched = directories.find(event->wd);
+            if (watched == directories.end() || event->len == 0) continue;
+
+            Watch entry = watched->second;
+            std::string path = joinPath(entry.directory, event->name);
+            if (event->mask & IN_ISDIR) {
+                // New subdirectories of a tree are watched as well
+                if ((event->mask & (IN_CREATE | IN_MOVED_TO)) && entry.recursive) watch(path, true);
+                continue;
+            }
+            if (accepts(path, entry.recursive)) {
+                changed.push_back(path);
+                any = true;
+            }
+        }
+    }
+}
+
+std::vector<std::string> DirectoryWatcher::wait(std::chrono::milliseconds debounce, const std::atomic<bool>& stop) {
+    std::vector<std::string> changed;
+    pollfd descriptor = {fd, POLLIN, 0};
+
+    // Wake up now and then to notice stop
+    while (!stop && changed.empty()) {
+        if (::poll(&descriptor, 1, 250) > 0) readEvents(changed);
+    }
+    // Quiet period: every new event restarts it
+    while (!stop && ::poll(&descriptor, 1, static_cast<int>(debounce.count())) > 0) {
+        readEvents(changed);
+    }
+    if (stop) return {};
+
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return changed;
+}
+
+#else
+
+namespace {
+
+const std::chrono::milliseconds pollInterval(1000);
+
+} // namespace
+
+DirectoryWatcher::DirectoryWatcher(const std::vector<std::string>& inputs)
+    : inputs(inputs) {
+    std::vector<std::string> ignored;
+    scan(ignored);
+}
+
+DirectoryWatcher::~DirectoryWatcher() = default;
+
+bool DirectoryWatcher::scan(std::vector<std::string>& changed) {
+    std::map<std::string, std::pair<std::filesystem::file_time_type, uintmax_t>> current;
+    bool any = false;
+    for (const auto& path : expandInputs(inputs)) {
+        if (!isBatchInput(path)) continue;
+        std::error_code error;
+        auto modified = std::filesystem::last_write_time(path, error);
+        if (error) continue;
+        uintmax_t size = std::filesystem::file_size(path, error);
+        if (error) continue;
+        auto& entry = current[path] = {modified, size};
+        auto previous = snapshot.find(path);
+        if (previous == snapshot.end() || previous->second != entry) {
+            changed.push_back(path);
+            any = true;
+        }
+    }
+    snapshot = std::move(current);
+    return any;
+}
+
+std::vector<std::string> DirectoryWatcher::wait(std::chrono::milliseconds debounce, const std::atomic<bool>& stop) {
+    std::vector<std::string> changed;
+
+    // Sleep in short steps to notice stop
+    auto sleep = [&stop](std::chrono::milliseconds duration) {
+        const std::chrono::milliseconds step(250);
+        for (auto slept = std::chrono::milliseconds(0); !stop && slept < duration; slept += step) {
+            std::this_thread::sleep_for(std::min(step, duration - slept));
+        }
+    };
+    while (!stop && changed.empty()) {
+        sleep(pollInterval);
+        if (!stop) scan(changed);
+    }
+    // Quiet period: every scan that finds a change restarts it
+    while (!stop) {
+        sleep(debounce);
+        if (stop || !scan(changed)) break;
+    }
+    if (stop) return {};
+
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return changed;
+}
+
+#endif
@@ -0,0 +1,324 @@
+#include "FileBatchReader.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <atomic>
+#include <cstring>
+#include <initializer_list>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <vector>
+#define FILE_BATCH_READER_IO_URING 1
+#endif
+
+namespace {
+
+// Bytes read per operation and file in flight
+const size_t slotSize = size_t(1) << 16;
+
+#ifdef __linux__
+// Reads a whole file with pread; 0 or the errno of the failure
+int readFile(const std::string& path, std::string& data) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return errno;
+    char buffer[slotSize];
+    int error = 0;
+    for (off_t offset = 0;;) {
+        ssize_t length = ::pread(fd, buffer, sizeof(buffer), offset);
+        if (length < 0 && errno == EINTR) continue;
+        if (length < 0) error = errno;
+        if (length <= 0) break;
+        data.append(buffer, static_cast<size_t>(length));
+        offset += length;
+    }
+    ::close(fd);
+    return error;
+}
+#else
+// Reads a whole file with an ifstream; 0 or the errno of the failure
+int readFile(const std::string& path, std::string& data) {
+    errno = 0;
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return errno ? errno : ENOENT;
+    char buffer[slotSize];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+        data.append(buffer, static_cast<size_t>(file.gcount()));
+    }
+    return file.bad() ? (errno ? errno : EIO) : 0;
+}
+#endif
+
+} // namespace
+
+#ifdef FILE_BATCH_READER_IO_URING
+
+// Submission and completion rings shared with the kernel, and the buffers
+// registered for the reads, one slot of slotSize bytes per file in flight
+struct FileBatchReader::Ring {
+    int fd = -1;
+    void* sqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    void* cqRing = MAP_FAILED;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize = 0;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    std::unique_ptr<char, decltype(&std::free)> buffers{nullptr, std::free};
+    bool registered = false; // Buffers registered, so reads use IORING_OP_READ_FIXED
+    unsigned unsubmitted = 0;
+
+    ~Ring() {
+        if (cqRing != MAP_FAILED && cqRing != sqRing) ::munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED) ::munmap(sqRing, sqRingSize);
+        if (sqes != MAP_FAILED) ::munmap(sqes, sqesSize);
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool setup(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0 || !supports({IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_READ_FIXED, IORING_OP_CLOSE})) {
+            return false;
+        }
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        sqRing = ::mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) return false;
+        cqRing = single ? sqRing : ::mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) return false;
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) return false;
+
+        char* sq = static_cast<char*>(sqRing);
+        char* cq = static_cast<char*>(cqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        buffers.reset(static_cast<char*>(std::aligned_alloc(4096, entries * slotSize)));
+        if (!buffers) return false;
+        std::vector<iovec> vectors(entries);
+        for (unsigned i = 0; i < entries; ++i) {
+            vectors[i].iov_base = buffers.get() + i * slotSize;
+            vectors[i].iov_len = slotSize;
+        }
+        // Fails under a low RLIMIT_MEMLOCK; plain reads work without it
+        registered = ::syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, vectors.data(), entries) == 0;
+        return true;
+    }
+
+    // Whether the kernel implements every one of the operations
+    bool supports(std::initializer_list<unsigned> operations) const {
+        const unsigned count = 256;
+        std::vector<char> storage(sizeof(io_uring_probe) + count * sizeof(io_uring_probe_op), 0);
+        io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, count) < 0) return false;
+        for (unsigned operation : operations) {
+            if (operation > probe->last_op || !(probe->ops[operation].flags & IO_URING_OP_SUPPORTED)) return false;
+        }
+        return true;
+    }
+
+    char* buffer(unsigned slot) const {
+        return buffers.get() + slot * slotSize;
+    }
+
+    // Next free submission entry; at most one operation per slot is in
+    // flight, so the ring never runs full
+    io_uring_sqe* next(unsigned slot) {
+        unsigned tail = *sqTail;
+        unsigned index = tail & *sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->user_data = slot;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++unsubmitted;
+        return sqe;
+    }
+
+    void open(unsigned slot, const std::string& path) {
+        io_uring_sqe* sqe = next(slot);
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uint64_t>(path.c_str());
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    }
+
+    void read(unsigned slot, int file, uint64_t offset) {
+        io_uring_sqe* sqe = next(slot);
+        sqe->opcode = registered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = file;
+        sqe->addr = reinterpret_cast<uint64_t>(buffer(slot));
+        sqe->len = slotSize;
+        sqe->off = offset;
+        sqe->buf_index = static_cast<uint16_t>(slot);
+    }
+
+    void close(unsigned slot, int file) {
+        io_uring_sqe* sqe = next(slot);
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = file;
+    }
+
+    // Submits the queued operations and waits for at least one completion
+    bool enter() {
+        while (true) {
+            long submitted = ::syscall(__NR_io_uring_enter, fd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (submitted >= 0) {
+                unsubmitted -= static_cast<unsigned>(submitted);
+                return true;
+            }
+            if (errno != EINTR) return false;
+        }
+    }
+};
+
+FileBatchReader::FileBatchReader(unsigned depth, bool ioUring)
+    : depth(std::max(1u, depth)) {
+    if (!ioUring) return;
+    ring = std::make_unique<Ring>();
+    if (!ring->setup(this->depth)) ring.reset();
+}
+
+void FileBatchReader::readAll(const std::vector<std::string>& paths, const Callback& onFile) {
+    if (!ring) {
+        readWithPread(paths, onFile);
+        return;
+    }
+
+    enum class Stage { Free, Opening, Reading, Closing };
+    struct Slot {
+        Stage stage = Stage::Free;
+        size_t index = 0;
+        int fd = -1;
+        uint64_t offset = 0;
+        int error = 0;
+        std::string data;
+    };
+    std::vector<Slot> slots(depth);
+    size_t nextFile = 0;
+    size_t active = 0;
+
+    auto start = [&](unsigned s) {
+        if (nextFile == paths.size()) return;
+        slots[s] = Slot();
+        slots[s].stage = Stage::Opening;
+        slots[s].index = nextFile;
+        ring->open(s, paths[nextFile++]);
+        ++active;
+    };
+    for (unsigned s = 0; s < depth; ++s) start(s);
+
+    while (active > 0) {
+        if (!ring->enter()) {
+            // The ring broke down; what was not read yet is read with pread
+            std::vector<std::string> rest(paths.begin() + static_cast<std::ptrdiff_t>(nextFile), paths.end());
+            for (auto& slot : slots) {
+                if (slot.stage == Stage::Free) continue;
+                if (slot.fd >= 0) ::close(slot.fd);
+                std::string data;
+                int error = readFile(paths[slot.index], data);
+                onFile(slot.index, std::move(data), error);
+            }
+            readWithPread(rest, [&](size_t index, std::string&& data, int error) {
+                onFile(nextFile + index, std::move(data), error);
+            });
+            return;
+        }
+
+        unsigned head = *ring->cqHead;
+        unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = ring->cqes[head & *ring->cqMask];
+            unsigned s = static_cast<unsigned>(cqe.user_data);
+            int result = cqe.res;
+            Slot& slot = slots[s];
+
+            switch (slot.stage) {
+            case Stage::Opening:
+                if (result < 0) {
+                    slot.stage = Stage::Free;
+                    --active;
+                    onFile(slot.index, std::string(), -result);
+                    start(s);
+                    break;
+                }
+                slot.fd = result;
+                slot.stage = Stage::Reading;
+                ring->read(s, slot.fd, 0);
+                break;
+            case Stage::Reading:
+                if (result > 0) {
+                    slot.data.append(ring->buffer(s), static_cast<size_t>(result));
+                    slot.offset += static_cast<uint64_t>(result);
+                    ring->read(s, slot.fd, slot.offset);
+                    break;
+                }
+                if (result < 0) slot.error = -result;
+                slot.stage = Stage::Closing;
+                ring->close(s, slot.fd);
+                break;
+            case Stage::Closing:
+                slot.stage = Stage::Free;
+                slot.fd = -1;
+                --active;
+                onFile(slot.index, std::move(slot.data), slot.error);
+                start(s);
+                break;
+            case Stage::Free:
+                break;
+            }
+        }
+        __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    }
+}
+
+#else
+
+struct FileBatchReader::Ring {};
+
+FileBatchReader::FileBatchReader(unsigned depth, bool)
+    : depth(depth) {}
+
+void FileBatchReader::readAll(const std::vector<std::string>& paths, const Callback& onFile) {
+    readWithPread(paths, onFile);
+}
+
+#endif
+
+FileBatchReader::~FileBatchReader() = default;
+
+void FileBatchReader::readWithPread(const std::vector<std::string>& paths, const Callback& onFile) {
+    for (size_t i = 0; i < paths.size(); ++i) {
+        std::string data;
+        int error = readFile(paths[i], data);
+        onFile(i, std::move(data), error);
+    }
+}
@@ -0,0 +1,137 @@
+#include "FileSniffer.hpp"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+struct Magic {
+    std::string_view bytes;
+    const char* name;
+    bool levelDigit; // Followed by a block size digit 1-9, as "BZh9"
+};
+
+const Magic compressionMagic[] = {
+    {std::string_view("\x1f\x8b", 2), "gzip", false},
+    {std::string_view("\x28\xb5\x2f\xfd", 4), "zstd", false},
+    {std::string_view("BZh", 3), "bzip2", true},
+    {std::string_view("\xfd\x37\x7a\x58\x5a\x00", 6), "xz", false},
+    {std::string_view("PK\x03\x04", 4), "zip", false}
+};
+
+const char delimiters[] = {',', '\t', ';', '|'};
+
+// Lines looked at to choose the delimiter
+const size_t sniffLines = 16;
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && isBlank(text.front())) text.remove_prefix(1);
+    while (!text.empty() && isBlank(text.back())) text.remove_suffix(1);
+    return text;
+}
+
+// The complete, non-empty lines of head; the last one only if head ends
+// with a newline or is the whole file
+std::vector<std::string_view> completeLines(std::string_view head, bool whole) {
+    std::vector<std::string_view> lines;
+    while (!head.empty() && lines.size() < sniffLines) {
+        size_t end = head.find('\n');
+        if (end == std::string_view::npos && !whole) break;
+        std::string_view line = head.substr(0, end);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (!line.empty()) lines.push_back(line);
+        if (end == std::string_view::npos) break;
+        head.remove_prefix(end + 1);
+    }
+    return lines;
+}
+
+// Occurrences of the delimiter outside double quotes
+size_t countCells(std::string_view line, char delimiter) {
+    size_t count = 0;
+    bool quoted = false;
+    for (char c : line) {
+        if (c == '"') quoted = !quoted;
+        else if (c == delimiter && !quoted) ++count;
+    }
+    return count;
+}
+
+// One object per line: the first line is a complete object and so is the
+// start of the next one, if there is one
+bool isNdjson(const std::vector<std::string_view>& lines) {
+    if (lines.empty()) return false;
+    std::string_view first = trim(lines[0]);
+    if (first.size() < 2 || first.back() != '}') return false;
+    return lines.size() == 1 || trim(lines[1]).substr(0, 1) == "{";
+}
+
+} // namespace
+
+SniffResult sniffContents(std::string_view head) {
+    SniffResult result;
+    for (const Magic& magic : compressionMagic) {
+        if (head.substr(0, magic.bytes.size()) != magic.bytes) continue;
+        size_t size = magic.bytes.size();
+        if (!magic.levelDigit || (head.size() > size && head[size] >= '1' && head[size] <= '9')) {
+            result.format = FileFormat::Compressed;
+            result.compression = magic.name;
+            return result;
+        }
+    }
+    // Binary data of some other kind
+    if (head.find('\0') != std::string_view::npos) return result;
+
+    bool whole = head.size() < sniffLength;
+    head = head.substr(0, sniffLength);
+    if (head.substr(0, 3) == "\xef\xbb\xbf") head.remove_prefix(3);
+    size_t start = 0;
+    while (start < head.size() && isBlank(head[start])) ++start;
+    if (start == head.size()) return result;
+
+    // An array holds values, so a row like "[a],1" is not taken for one
+    size_t first = start + 1;
+    while (first < head.size() && isBlank(head[first])) ++first;
+    if (head[start] == '[' && (first == head.size() || std::string_view("[{\"-0123456789tfn]").find(head[first]) != std::string_view::npos)) {
+        result.format = FileFormat::Json;
+        return result;
+    }
+    std::vector<std::string_view> lines = completeLines(head.substr(start), whole);
+    if (head[start] == '{') {
+        result.format = isNdjson(lines) ? FileFormat::Ndjson : FileFormat::Json;
+        return result;
+    }
+
+    // The delimiter splitting the most lines into as many cells as the header
+    // wins, then the one giving more cells; footer lines may differ
+    size_t bestCells = 0;
+    size_t bestMatches = 0;
+    for (char delimiter : delimiters) {
+        size_t cells = lines.empty() ? 0 : countCells(lines[0], delimiter);
+        if (cells == 0) continue;
+        size_t matches = std::count_if(lines.begin(), lines.end(), [&](std::string_view line) {
+            return countCells(line, delimiter) == cells;
+        });
+        if (matches * 2 < lines.size() + 1) continue;
+        if (matches > bestMatches || (matches == bestMatches && cells > bestCells)) {
+            bestMatches = matches;
+            bestCells = cells;
+            result.delimiter = delimiter;
+        }
+    }
+    if (bestCells > 0) result.format = FileFormat::Csv;
+    return result;
+}
+
+SniffResult sniffFile(const std::string& filePath) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file.is_open()) return SniffResult();
+    std::string head(sniffLength, '\0');
+    file.read(head.data(), static_cast<std::streamsize>(head.size()));
+    head.resize(static_cast<size_t>(file.gcount()));
+    return sniffContents(head);
+}
@@ -0,0 +1,78 @@
+#include "GroupBy.hpp"
+#include <algorithm>
+#include <thread>
+
+namespace {
+
+// Below this many rows per worker, starting a thread costs more than it saves
+const size_t minRowsPerThread = 1 << 16;
+
+void aggregateSlice(const std::vector<std::string_view>& ids, const std::vector<double>& values,
+                    size_t begin, size_t end, GroupTable& table) {
+    for (size_t row = begin; row < end; ++row) {
+        table[ids[row]].add(values[row], row);
+    }
+}
+
+} // namespace
+
+void GroupStatistics::add(double value, size_t row) {
+    if (count == 0) firstRow = row;
+    ++count;
+    sum += value;
+    min = std::min(min, value);
+    max = std::max(max, value);
+}
+
+void GroupStatistics::merge(const GroupStatistics& other) {
+    if (other.count == 0) return;
+    firstRow = count == 0 ? other.firstRow : std::min(firstRow, other.firstRow);
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+GroupTable aggregateGroups(const std::vector<std::string_view>& ids, const std::vector<double>& values, unsigned threads) {
+    size_t rows = std::min(ids.size(), values.size());
+    size_t workers = std::clamp<size_t>(rows / minRowsPerThread, 1, std::max(1u, threads));
+
+    if (workers == 1) {
+        GroupTable table;
+        aggregateSlice(ids, values, 0, rows, table);
+        return table;
+    }
+
+    // Pre-aggregate each slice into a private table, then merge into the first
+    std::vector<GroupTable> tables(workers);
+    std::vector<std::thread> pool;
+    size_t sliceSize = (rows + workers - 1) / workers;
+    for (size_t w = 0; w < workers; ++w) {
+        size_t begin = std::min(rows, w * sliceSize);
+        size_t end = std::min(rows, begin + sliceSize);
+        pool.emplace_back(aggregateSlice, std::cref(ids), std::cref(values), begin, end, std::ref(tables[w]));
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    GroupTable& merged = tables.front();
+    for (size_t w = 1; w < workers; ++w) {
+        tables[w].forEach([&merged](const std::string& id, const GroupStatistics& group) {
+            merged[id].merge(group);
+        });
+    }
+    return std::move(merged);
+}
+
+std::vector<std::pair<std::string, GroupStatistics>> sortedGroups(const GroupTable& table) {
+    std::vector<std::pair<std::string, GroupStatistics>> groups;
+    groups.reserve(table.size());
+    table.forEach([&groups](const std::string& id, const GroupStatistics& group) {
+        groups.emplace_back(id, group);
+    });
+    std::sort(groups.begin(), groups.end(), [](const auto& a, const auto& b) {
+        return a.second.firstRow < b.second.firstRow;
+    });
+    return groups;
+}
@@ -0,0 +1,220 @@
+#include "Hash.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t prime3 = 0x165667B19E3779F9ULL;
+const uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t read64(const unsigned char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t mixRound(uint64_t accumulator, uint64_t input) {
+    accumulator += input * prime2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * prime1;
+}
+
+inline uint64_t mergeRound(uint64_t accumulator, uint64_t value) {
+    accumulator ^= mixRound(0, value);
+    return accumulator * prime1 + prime4;
+}
+
+// Keys xored into the stripes and into the lanes when scrambling them
+alignas(16) const uint64_t stripeKeys[8] = {
+    0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL, 0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+    0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL, 0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL
+};
+alignas(16) const uint64_t scrambleKeys[8] = {
+    0xCB00C391BB52283CULL, 0xA32E531B8B65D088ULL, 0x4EF90DA297486471ULL, 0xD8ACDEA946EF1938ULL,
+    0x3F349CE33F76FAA8ULL, 0x1D4F0BC7C7BBDCF9ULL, 0x3159B4CD4BE0518AULL, 0x647378D9C97E9FC8ULL
+};
+const uint64_t scramblePrime = 0x9E3779B1ULL;
+const size_t stripesPerScramble = 16;
+
+// Folded 128-bit product
+inline uint64_t multiplyFold(uint64_t a, uint64_t b) {
+    uint64_t high;
+    uint64_t low = multiply128(a, b, high);
+    return low ^ high;
+}
+
+inline uint64_t avalanche(uint64_t hash) {
+    hash ^= hash >> 37;
+    hash *= 0x165667919E3779F9ULL;
+    return hash ^ (hash >> 32);
+}
+
+} // namespace
+
+ContentHasher::ContentHasher()
+    : lanes{prime3, prime1, prime2, prime4, prime5, prime3 ^ prime2, prime4 ^ prime1, prime5 ^ prime3},
+      pendingSize(0), stripes(0), length(0) {}
+
+void ContentHasher::consume(const unsigned char* data, size_t count) {
+#if defined(__SSE2__)
+    __m128i lane[4];
+    for (int j = 0; j < 4; ++j) lane[j] = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes) + j);
+#endif
+    for (size_t s = 0; s < count; ++s, data += 64) {
+#if defined(__SSE2__)
+        for (int j = 0; j < 4; ++j) {
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data) + j);
+            __m128i keyed = _mm_xor_si128(value, _mm_load_si128(reinterpret_cast<const __m128i*>(stripeKeys) + j));
+            // Low times high 32 bits of every keyed lane
+            __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+            // The raw input goes to the neighbouring lane
+            __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            lane[j] = _mm_add_epi64(lane[j], _mm_add_epi64(product, swapped));
+        }
+#else
+        for (int i = 0; i < 8; ++i) {
+            uint64_t value = read64(data + 8 * i);
+            uint64_t keyed = value ^ stripeKeys[i];
+            lanes[i ^ 1] += value;
+            lanes[i] += (keyed & 0xFFFFFFFFULL) * (keyed >> 32);
+        }
+#endif
+        if (++stripes == stripesPerScramble) {
+            stripes = 0;
+#if defined(__SSE2__)
+            const __m128i prime = _mm_set1_epi32(static_cast<int>(scramblePrime));
+            for (int j = 0; j < 4; ++j) {
+                __m128i value = _mm_xor_si128(lane[j], _mm_srli_epi64(lane[j], 47));
+                value = _mm_xor_si128(value, _mm_load_si128(reinterpret_cast<const __m128i*>(scrambleKeys) + j));
+                // 64 by 32 bit multiply from two 32x32->64 products
+                __m128i low = _mm_mul_epu32(value, prime);
+                __m128i high = _mm_mul_epu32(_mm_srli_epi64(value, 32), prime);
+                lane[j] = _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+            }
+#else
+            for (int i = 0; i < 8; ++i) {
+                uint64_t value = lanes[i] ^ (lanes[i] >> 47) ^ scrambleKeys[i];
+                lanes[i] = value * scramblePrime;
+            }
+#endif
+        }
+    }
+#if defined(__SSE2__)
+    for (int j = 0; j < 4; ++j) _mm_store_si128(reinterpret_cast<__m128i*>(lanes) + j, lane[j]);
+#endif
+}
+
+void ContentHasher::update(const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    length += size;
+    if (pendingSize > 0) {
+        size_t take = std::min(size, sizeof(pending) - pendingSize);
+        std::memcpy(pending + pendingSize, p, take);
+        pendingSize += take;
+        p += take;
+        size -= take;
+        if (pendingSize < sizeof(pending)) return;
+        consume(pending, 1);
+        pendingSize = 0;
+    }
+    consume(p, size / 64);
+    pendingSize = size % 64;
+    std::memcpy(pending, p + size - pendingSize, pendingSize);
+}
+
+uint64_t ContentHasher::digest() const {
+    uint64_t hash = length * prime1;
+    for (int i = 0; i < 8; i += 2) {
+        hash += multiplyFold(lanes[i] ^ stripeKeys[i], lanes[i + 1] ^ stripeKeys[i + 1]);
+    }
+    hash ^= hash64(pending, pendingSize, hash);
+    return avalanche(hash);
+}
+
+bool hashFile(const std::string& path, uint64_t& hash) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    ContentHasher hasher;
+    std::vector<char> block(size_t(1) << 20);
+    while (file) {
+        file.read(block.data(), static_cast<std::streamsize>(block.size()));
+        hasher.update(block.data(), static_cast<size_t>(file.gcount()));
+    }
+    if (file.bad()) return false;
+    hash = hasher.digest();
+    return true;
+}
+
+uint64_t hash64(const void* data, size_t length, uint64_t seed) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+    uint64_t hash;
+
+    if (length >= 32) {
+        // Four independent lanes consume 32 byte stripes
+        uint64_t v1 = seed + prime1 + prime2;
+        uint64_t v2 = seed + prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - prime1;
+        const unsigned char* limit = end - 32;
+        do {
+            v1 = mixRound(v1, read64(p));
+            v2 = mixRound(v2, read64(p + 8));
+            v3 = mixRound(v3, read64(p + 16));
+            v4 = mixRound(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        hash = mergeRound(hash, v1);
+        hash = mergeRound(hash, v2);
+        hash = mergeRound(hash, v3);
+        hash = mergeRound(hash, v4);
+    }
+    else {
+        hash = seed + prime5;
+    }
+    hash += static_cast<uint64_t>(length);
+
+    // Remaining tail bytes
+    for (; p + 8 <= end; p += 8) {
+        hash ^= mixRound(0, read64(p));
+        hash = rotateLeft(hash, 27) * prime1 + prime4;
+    }
+    if (p + 4 <= end) {
+        hash ^= static_cast<uint64_t>(read32(p)) * prime1;
+        hash = rotateLeft(hash, 23) * prime2 + prime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash ^= (*p) * prime5;
+        hash = rotateLeft(hash, 11) * prime1;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
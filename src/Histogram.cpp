@@ -0,0 +1,175 @@
+#include "Histogram.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+void serializeBuckets(std::ostringstream& out, const std::vector<std::pair<int64_t, uint64_t>>& buckets) {
+    bool first = true;
+    int64_t previous = 0;
+    for (const auto& [index, count] : buckets) {
+        if (!first) out << '/';
+        out << (first ? index : index - previous) << ':' << count;
+        previous = index;
+        first = false;
+    }
+}
+
+// Parses a bucket list written by serializeBuckets into (index, count) pairs
+bool parseBuckets(const std::string& text, std::vector<std::pair<int64_t, uint64_t>>& buckets) {
+    std::stringstream listStream(text);
+    std::string item;
+    bool first = true;
+    int64_t index = 0;
+    while (std::getline(listStream, item, '/')) {
+        size_t colon = item.find(':');
+        if (colon == std::string::npos) return false;
+        try {
+            int64_t delta = std::stoll(item.substr(0, colon));
+            uint64_t count = std::stoull(item.substr(colon + 1));
+            index = first ? delta : index + delta;
+            buckets.emplace_back(index, count);
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+        first = false;
+    }
+    return true;
+}
+
+} // namespace
+
+Histogram::Histogram(int significantDigits)
+    : significantDigits(std::clamp(significantDigits, 1, 5)), zeroCount(0) {
+    // 2^bits sub-buckets bound the relative error by 2^-bits <= 10^-digits
+    subBucketBits = static_cast<int>(std::ceil(this->significantDigits * std::log2(10.0)));
+}
+
+size_t Histogram::IndexHash::operator()(int64_t index) const {
+    // splitmix64 finalizer
+    uint64_t x = static_cast<uint64_t>(index);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return static_cast<size_t>(x ^ (x >> 31));
+}
+
+std::vector<std::pair<int64_t, uint64_t>> Histogram::sorted(const Buckets& buckets) {
+    std::vector<std::pair<int64_t, uint64_t>> result;
+    result.reserve(buckets.size());
+    buckets.forEach([&result](int64_t index, uint64_t count) { result.emplace_back(index, count); });
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+int64_t Histogram::bucketIndex(double magnitude) const {
+    int exponent = 0;
+    double mantissa = std::frexp(magnitude, &exponent); // magnitude = mantissa * 2^exponent, mantissa in [0.5, 1)
+    int64_t subBuckets = int64_t(1) << subBucketBits;
+    int64_t subBucket = static_cast<int64_t>((mantissa * 2.0 - 1.0) * subBuckets);
+    subBucket = std::min(subBucket, subBuckets - 1);
+    return static_cast<int64_t>(exponent) * subBuckets + subBucket;
+}
+
+double Histogram::bucketValue(int64_t index) const {
+    int64_t subBuckets = int64_t(1) << subBucketBits;
+    int64_t exponent = index >= 0 ? index / subBuckets : -((-index + subBuckets - 1) / subBuckets);
+    int64_t subBucket = index - exponent * subBuckets;
+    // Midpoint of [1 + sub / n, 1 + (sub + 1) / n) * 2^(exponent - 1)
+    double mantissa = 1.0 + (subBucket + 0.5) / subBuckets;
+    return std::ldexp(mantissa, static_cast<int>(exponent - 1));
+}
+
+void Histogram::record(double value, uint64_t count) {
+    if (!std::isfinite(value) || count == 0) return;
+
+    if (value > 0) {
+        positive[bucketIndex(value)] += count;
+    }
+    else if (value < 0) {
+        negative[bucketIndex(-value)] += count;
+    }
+    else {
+        zeroCount += count;
+    }
+}
+
+bool Histogram::merge(const Histogram& other) {
+    if (other.significantDigits != significantDigits) return false;
+
+    zeroCount += other.zeroCount;
+    other.positive.forEach([this](int64_t index, uint64_t count) { positive[index] += count; });
+    other.negative.forEach([this](int64_t index, uint64_t count) { negative[index] += count; });
+    return true;
+}
+
+uint64_t Histogram::totalCount() const {
+    uint64_t total = zeroCount;
+    auto add = [&total](int64_t, uint64_t count) { total += count; };
+    positive.forEach(add);
+    negative.forEach(add);
+    return total;
+}
+
+double Histogram::valueAtPercentile(double percentile) const {
+    uint64_t total = totalCount();
+    if (total == 0) return 0.0;
+
+    double clamped = std::clamp(percentile, 0.0, 100.0);
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * total)));
+
+    // Walk from the most negative bucket up to the largest positive one
+    uint64_t seen = 0;
+    std::vector<std::pair<int64_t, uint64_t>> negativeBuckets = sorted(negative);
+    for (auto bucket = negativeBuckets.rbegin(); bucket != negativeBuckets.rend(); ++bucket) {
+        seen += bucket->second;
+        if (seen >= rank) return -bucketValue(bucket->first);
+    }
+    seen += zeroCount;
+    if (seen >= rank) return 0.0;
+    for (const auto& [index, count] : sorted(positive)) {
+        seen += count;
+        if (seen >= rank) return bucketValue(index);
+    }
+    return 0.0;
+}
+
+std::string Histogram::serialize() const {
+    std::ostringstream out;
+    out << significantDigits << ';' << zeroCount << ';';
+    serializeBuckets(out, sorted(positive));
+    out << ';';
+    serializeBuckets(out, sorted(negative));
+    return out.str();
+}
+
+bool Histogram::deserialize(const std::string& text, Histogram& histogram) {
+    std::vector<std::string> fields;
+    std::stringstream textStream(text);
+    std::string field;
+    while (std::getline(textStream, field, ';')) {
+        fields.push_back(field);
+    }
+    if (!text.empty() && text.back() == ';') fields.push_back(""); // Empty negative list
+    if (fields.size() != 4) return false;
+
+    std::vector<std::pair<int64_t, uint64_t>> positiveBuckets;
+    std::vector<std::pair<int64_t, uint64_t>> negativeBuckets;
+    Histogram result;
+    try {
+        result = Histogram(std::stoi(fields[0]));
+        result.zeroCount = std::stoull(fields[1]);
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    if (!parseBuckets(fields[2], positiveBuckets) || !parseBuckets(fields[3], negativeBuckets)) {
+        return false;
+    }
+
+    for (const auto& bucket : positiveBuckets) result.positive[bucket.first] += bucket.second;
+    for (const auto& bucket : negativeBuckets) result.negative[bucket.first] += bucket.second;
+    histogram = result;
+    return true;
+}
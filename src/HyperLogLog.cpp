@@ -0,0 +1,93 @@
+#include "HyperLogLog.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+
+HyperLogLog::HyperLogLog(int precision)
+    : precision(std::clamp(precision, 4, 18)), registers(size_t(1) << this->precision, 0) {}
+
+void HyperLogLog::addHash(uint64_t hash) {
+    // The top bits pick the register, the rest supply the zero run
+    size_t index = static_cast<size_t>(hash >> (64 - precision));
+    uint64_t remaining = hash << precision;
+    uint8_t rank = 1;
+    while (rank <= 64 - precision && (remaining & (uint64_t(1) << 63)) == 0) {
+        remaining <<= 1;
+        ++rank;
+    }
+    registers[index] = std::max(registers[index], rank);
+}
+
+void HyperLogLog::add(std::string_view key) {
+    addHash(hash64(key));
+}
+
+bool HyperLogLog::merge(const HyperLogLog& other) {
+    if (other.precision != precision) return false;
+    for (size_t i = 0; i < registers.size(); ++i) {
+        registers[i] = std::max(registers[i], other.registers[i]);
+    }
+    return true;
+}
+
+uint64_t HyperLogLog::estimate() const {
+    double m = static_cast<double>(registers.size());
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (uint8_t value : registers) {
+        sum += std::ldexp(1.0, -value);
+        if (value == 0) ++zeros;
+    }
+
+    double alpha = 0.7213 / (1.0 + 1.079 / m);
+    if (registers.size() == 16) alpha = 0.673;
+    else if (registers.size() == 32) alpha = 0.697;
+    else if (registers.size() == 64) alpha = 0.709;
+    double estimate = alpha * m * m / sum;
+
+    // Small cardinalities are estimated far better by linear counting
+    if (estimate <= 2.5 * m && zeros != 0) {
+        estimate = m * std::log(m / zeros);
+    }
+    return static_cast<uint64_t>(std::llround(estimate));
+}
+
+std::string HyperLogLog::serialize() const {
+    static const char digits[] = "0123456789abcdef";
+    std::string text = std::to_string(precision) + ";";
+    text.reserve(text.size() + 2 * registers.size());
+    for (uint8_t value : registers) {
+        text += digits[value >> 4];
+        text += digits[value & 0xf];
+    }
+    return text;
+}
+
+bool HyperLogLog::deserialize(const std::string& text, HyperLogLog& sketch) {
+    size_t separator = text.find(';');
+    if (separator == std::string::npos) return false;
+    HyperLogLog result;
+    try {
+        result = HyperLogLog(std::stoi(text.substr(0, separator)));
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+
+    std::string_view hex = std::string_view(text).substr(separator + 1);
+    if (hex.size() != 2 * result.registers.size()) return false;
+    auto nibble = [](char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+    for (size_t i = 0; i < result.registers.size(); ++i) {
+        int high = nibble(hex[2 * i]);
+        int low = nibble(hex[2 * i + 1]);
+        if (high < 0 || low < 0) return false;
+        result.registers[i] = static_cast<uint8_t>(high << 4 | low);
+    }
+    sketch = result;
+    return true;
+}
@@ -1,97 +1,358 @@
 #include "JsonFileHandler.hpp"
+#include "AtomicFileWriter.hpp"
+#include "Parallel.hpp"
+#include "RollingStatistics.hpp"
+#include "StatisticsJson.hpp"
+#include <filesystem>
 #include <fstream>
-#include <iostream>
-#include <algorithm>
-#include <cmath>
-#include <numeric>
+#include <iomanip>
+#include <optional>
+#include <set>
+#include <utility>
 
 // Constructor initializing member variables
-JsonFileHandler::JsonFileHandler(const std::string& filePath)
-    : filePath(filePath), mean(0), median(0), std_dev(0), hasInvalidData(false) {}
+JsonFileHandler::JsonFileHandler(const std::string& filePath, const ProcessingOptions& options)
+    : filePath(filePath), options(options), parseFailed(false), hasInvalidData(false), processed(false) {}
+
+bool JsonFileHandler::reset(const std::string& filePath, const ProcessingOptions& options) {
+    nlohmann::json entries = std::move(jsonData);
+    *this = JsonFileHandler(filePath, options);
+    if (entries.is_array()) {
+        entries.clear();
+        jsonData = std::move(entries);
+    }
+    return true;
+}
 
 void JsonFileHandler::readData() {
     std::ifstream file(filePath);
     if (file.is_open()) {
-        try {
-            file >> jsonData;
+        std::error_code error;
+        uint64_t size = std::filesystem::file_size(filePath, error);
+        if (!error) readSize = size;
+        readStream(file);
+        file.close();
+    }
+    else {
+        setError("Unable to open file: " + filePath);
+    }
+}
+
+bool JsonFileHandler::readContents(std::string contents) {
+    return readBuffer(contents);
+}
+
+bool JsonFileHandler::readBuffer(std::string_view data) {
+    readSize = data.size();
+    // An empty file holds no entries, which is not a parse error
+    if (data.find_first_not_of(" \t\r\n") == std::string_view::npos) {
+        jsonData = nlohmann::json::array();
+        return true;
+    }
+    try {
+        jsonData = nlohmann::json::parse(data.begin(), data.end());
+    }
+    catch (const nlohmann::json::parse_error& e) {
+        setError(std::string("JSON parse error: ") + e.what());
+        jsonData = nlohmann::json::array(); // Set to empty array on parse error
+        parseFailed = true;
+    }
+    return true;
+}
+
+bool JsonFileHandler::readStream(std::istream& input) {
+    if ((input >> std::ws).peek() == std::char_traits<char>::eof()) {
+        jsonData = nlohmann::json::array();
+        return true;
+    }
+    try {
+        input >> jsonData;
+    }
+    catch (const nlohmann::json::parse_error& e) {
+        setError(std::string("JSON parse error: ") + e.what());
+        jsonData = nlohmann::json::array(); // Set to empty array on parse error
+        parseFailed = true;
+    }
+    return true;
+}
+
+void JsonFileHandler::writeData() {
+    // Rewriting the entries that were parsed would lose the rest of the file
+    if (parseFailed) return;
+
+    if (options.output == OutputMode::Sidecar) {
+        if (!statsEntry.is_null()) {
+            if (writeStatisticsSidecar(filePath, statsEntry)) finalSize = readSize;
+            else setError("Unable to write file: " + filePath + ".stats.json");
         }
-        catch (const nlohmann::json::parse_error& e) {
-            std::cerr << "JSON parse error: " << e.what() << std::endl;
-            jsonData = nlohmann::json::array(); // Set to empty array on parse error
+    }
+    else {
+        AtomicFileWriter file(filePath);
+        if (file.isOpen()) {
+            // The statistics are stored as the last entry of the array
+            if (!statsEntry.is_null()) jsonData.push_back(statsEntry);
+            writeDocument(file);
+            uint64_t size = static_cast<uint64_t>(file.tellp());
+            if (file.commit()) finalSize = size;
         }
+        if (!finalSize) setError("Unable to write file: " + filePath);
+    }
+
+    if (!hasInvalidData && !groups.empty()) {
+        writeGroups();
+    }
+    if (covariance) {
+        writeCorrelation();
+    }
+    if (!hasInvalidData && options.writeOutliers && !options.allColumns) {
+        writeOutliers();
+    }
+}
+
+void JsonFileHandler::writeDocument(std::ostream& file) const {
+    // Streamed straight into the writer's buffer, without a dump() copy
+    file << std::setw(4) << jsonData;
+}
+
+void JsonFileHandler::writeOutliers() {
+    // Rows are indices into the original array
+    nlohmann::json outliersData = nlohmann::json::array();
+    for (const Outlier& outlier : stats.outliers) {
+        outliersData.push_back({
+            {"row", outlier.row},
+            {"id", jsonData[outlier.row].value("id", nlohmann::json())},
+            {"value", outlier.value}
+        });
+    }
+
+    std::string outliersPath = filePath + ".outliers.json";
+    std::ofstream file(outliersPath);
+    if (file.is_open()) {
+        file << outliersData.dump(4);
         file.close();
     }
     else {
-        std::cerr << "Unable to open file: " << filePath << std::endl;
+        setError("Unable to open file: " + outliersPath);
     }
 }
 
-void JsonFileHandler::writeData() {
-    std::ofstream file(filePath);
+void JsonFileHandler::writeCorrelation() {
+    nlohmann::json covarianceRows = nlohmann::json::array();
+    nlohmann::json correlationRows = nlohmann::json::array();
+    for (size_t i = 0; i < correlationColumns.size(); ++i) {
+        nlohmann::json covarianceRow = nlohmann::json::array();
+        nlohmann::json correlationRow = nlohmann::json::array();
+        for (size_t j = 0; j < correlationColumns.size(); ++j) {
+            covarianceRow.push_back(covariance->covariance(i, j));
+            correlationRow.push_back(covariance->correlation(i, j));
+        }
+        covarianceRows.push_back(covarianceRow);
+        correlationRows.push_back(correlationRow);
+    }
+    nlohmann::json matrixData = {
+        {"columns", correlationColumns},
+        {"covariance", covarianceRows},
+        {"correlation", correlationRows}
+    };
+
+    std::string matrixPath = filePath + ".correlation.json";
+    std::ofstream file(matrixPath);
     if (file.is_open()) {
-        file << jsonData.dump(4);
+        file << matrixData.dump(4);
         file.close();
     }
     else {
-        std::cerr << "Unable to open file: " << filePath << std::endl;
+        setError("Unable to open file: " + matrixPath);
+    }
+}
+
+void JsonFileHandler::writeGroups() {
+    nlohmann::json groupsData = nlohmann::json::array();
+    for (const auto& [id, group] : groups) {
+        groupsData.push_back({
+            {"id", nlohmann::json::parse(id)}, // Keys hold the serialized id
+            {"count", group.count},
+            {"mean", group.mean()},
+            {"min", group.min},
+            {"max", group.max}
+        });
+    }
+
+    std::string groupsPath = filePath + ".groups.json";
+    std::ofstream file(groupsPath);
+    if (file.is_open()) {
+        file << groupsData.dump(4);
+        file.close();
+    }
+    else {
+        setError("Unable to open file: " + groupsPath);
     }
 }
 
 void JsonFileHandler::process() {
+    // The statistics entry an earlier run appended is replaced, not read as data
+    if (jsonData.is_array() && !jsonData.empty() && isStatisticsEntry(jsonData.back())) {
+        jsonData.erase(jsonData.end() - 1);
+    }
     if (jsonData.empty()) {
-        std::cerr << "JSON data is empty.\n";
+        setError("JSON data is empty.");
+        return;
+    }
+
+    if (options.distinctIds) {
+        idSketch.emplace();
+    }
+    if (options.topK > 0) {
+        topIds.emplace(options.heavyHitterCapacity());
+    }
+
+    if (options.correlation) {
+        processCorrelation();
+    }
+
+    if (options.allColumns) {
+        processAllColumns();
         return;
     }
 
+    // Ids are keyed by their serialized form, so 7 and "7" stay distinct
+    bool needIds = options.groupBy || idSketch || topIds;
     std::vector<double> values;
+    std::vector<std::string> idKeys;
     for (const auto& item : jsonData) {
         try {
             values.push_back(item.at("value").get<double>());
+            if (needIds) {
+                std::string idKey = item.value("id", nlohmann::json()).dump();
+                sketchId(idKey);
+                if (options.groupBy) idKeys.push_back(std::move(idKey));
+            }
         }
         catch (const nlohmann::json::type_error& e) {
-            std::cerr << "Invalid value in JSON file: " << e.what() << "\n";
+            setError(std::string("Invalid value in JSON file: ") + e.what());
+            hasInvalidData = true;
+            return;
+        }
+        catch (const nlohmann::json::out_of_range& e) {
+            setError(std::string("Missing value in JSON file: ") + e.what());
             hasInvalidData = true;
             return;
         }
     }
 
     if (values.empty()) {
-        std::cerr << "No valid data to process.\n";
+        setError("No valid data to process.");
         return;
     }
 
-    calculateStatistics(values);
-    
-    nlohmann::json stats = {
-        {"mean", mean},
-        {"median", median},
-        {"std_dev", std_dev}
-    };
+    stats = calculateStatistics(values, options);
+    processed = true;
 
-        
-    jsonData.push_back(stats);
+    if (options.rollingWindow > 0) {
+        // Rolling window statistics are added to every entry as derived keys
+        std::vector<RollingValues> rolling = calculateRollingStatistics(values, options.rollingWindow);
+        for (size_t i = 0; i < rolling.size(); ++i) {
+            jsonData[i]["rolling_mean"] = rolling[i].mean;
+            jsonData[i]["rolling_std_dev"] = rolling[i].std_dev;
+            jsonData[i]["rolling_min"] = rolling[i].min;
+            jsonData[i]["rolling_max"] = rolling[i].max;
+        }
+    }
+
+    if (options.groupBy) {
+        std::vector<std::string_view> ids(idKeys.begin(), idKeys.end());
+        groups = sortedGroups(aggregateGroups(ids, values, options.threadCount()));
+    }
+
+    statsEntry = statisticsEntry(stats, options);
+    addIdStatistics(statsEntry, idSketch, topIds, options, true);
 }
 
-void JsonFileHandler::calculateStatistics(const std::vector<double>& values) {
-    if (values.empty()) return;
+void JsonFileHandler::processAllColumns() {
+    // Candidate keys are gathered from every entry, since entries may be
+    // sparse; the id is never aggregated
+    std::vector<std::string> keys;
+    std::set<std::string> seen;
+    for (const auto& item : jsonData) {
+        if (!item.is_object()) continue;
+        if (idSketch || topIds) sketchId(item.value("id", nlohmann::json()).dump());
+        for (const auto& [key, value] : item.items()) {
+            if (key != "id" && value.is_number() && seen.insert(key).second) keys.push_back(key);
+        }
+    }
 
-    // Calculate mean
-    double sum = std::accumulate(values.begin(), values.end(), 0.0);
-    mean = sum / values.size();
+    // Each worker extracts and summarises whole keys. Entries without the key
+    // are skipped; a single non-numeric value drops the key.
+    std::vector<std::optional<ColumnStatistics>> results(keys.size());
+    parallelFor(keys.size(), options.threadCount(), [&](size_t column) {
+        std::vector<double> values;
+        values.reserve(jsonData.size());
+        for (const auto& item : jsonData) {
+            if (!item.is_object()) continue;
+            auto it = item.find(keys[column]);
+            if (it == item.end()) continue;
+            if (!it->is_number()) return;
+            values.push_back(it->get<double>());
+        }
+        results[column] = ColumnStatistics{column, keys[column], calculateStatistics(values, options)};
+    });
 
-    // Sort values to calculate median
-    std::vector<double> sorted_values = values;
-    std::sort(sorted_values.begin(), sorted_values.end());
+    nlohmann::json entry = nlohmann::json::object();
+    for (auto& result : results) {
+        if (!result) continue;
+        entry[result->name] = statisticsEntry(result->stats, options);
+        columnStats.push_back(std::move(*result));
+    }
+    if (columnStats.empty()) {
+        setError("No numeric keys to process.");
+        return;
+    }
+    addIdStatistics(entry, idSketch, topIds, options, true);
+    statsEntry = entry;
+    processed = true;
+}
 
-    // Calculate median
-    if (sorted_values.size() % 2 == 0) {
-        median = (sorted_values[sorted_values.size() / 2 - 1] + sorted_values[sorted_values.size() / 2]) / 2;
+void JsonFileHandler::processCorrelation() {
+    // Candidate keys come from the first entry; only keys holding a number
+    // in every entry take part
+    std::vector<std::string> keys;
+    if (jsonData.is_array() && jsonData.front().is_object()) {
+        for (const auto& [key, value] : jsonData.front().items()) {
+            if (key != "id" && value.is_number()) keys.push_back(key);
+        }
     }
-    else {
-        median = sorted_values[sorted_values.size() / 2];
+
+    // Extract the keys into columnar arrays, one key per task
+    std::vector<std::vector<double>> parsed(keys.size());
+    std::vector<char> dense(keys.size(), 0);
+    parallelFor(keys.size(), options.threadCount(), [&](size_t column) {
+        std::vector<double> values;
+        values.reserve(jsonData.size());
+        for (const auto& item : jsonData) {
+            auto it = item.is_object() ? item.find(keys[column]) : item.end();
+            if (it == item.end() || !it->is_number()) return;
+            values.push_back(it->get<double>());
+        }
+        parsed[column] = std::move(values);
+        dense[column] = 1;
+    });
+
+    std::vector<std::vector<double>> columns;
+    for (size_t column = 0; column < keys.size(); ++column) {
+        if (!dense[column]) continue;
+        correlationColumns.push_back(keys[column]);
+        columns.push_back(std::move(parsed[column]));
+    }
+    if (columns.size() < 2) {
+        setError("Correlation needs at least two numeric keys.");
+        correlationColumns.clear();
+        return;
     }
 
-    // Calculate standard deviation
-    double sq_sum = std::inner_product(values.begin(), values.end(), values.begin(), 0.0);
-    std_dev = std::sqrt(sq_sum / values.size() - mean * mean);
+    covariance = calculateCovariance(columns, options.threadCount());
+}
+
+void JsonFileHandler::sketchId(std::string_view id) {
+    if (idSketch) idSketch->add(id);
+    if (topIds) topIds->add(id);
 }
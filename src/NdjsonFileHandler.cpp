@@ -0,0 +1,69 @@
+#include "NdjsonFileHandler.hpp"
+#include <filesystem>
+#include <fstream>
+
+NdjsonFileHandler::NdjsonFileHandler(const std::string& filePath, const ProcessingOptions& options)
+    : JsonFileHandler(filePath, options) {}
+
+void NdjsonFileHandler::clearEntries() {
+    // An array kept by reset() is refilled in place
+    if (jsonData.is_array()) jsonData.clear();
+    else jsonData = nlohmann::json::array();
+}
+
+bool NdjsonFileHandler::parseLine(std::string_view line, size_t lineNumber) {
+    if (line.find_first_not_of(" \t\r") == std::string_view::npos) return true;
+    try {
+        jsonData.push_back(nlohmann::json::parse(line));
+    }
+    catch (const nlohmann::json::parse_error& e) {
+        setError(std::string("JSON parse error on line ") + std::to_string(lineNumber) + ": " + e.what());
+        jsonData = nlohmann::json::array(); // Set to empty array on parse error
+        parseFailed = true;
+        return false;
+    }
+    return true;
+}
+
+void NdjsonFileHandler::readData() {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        setError("Unable to open file: " + filePath);
+        return;
+    }
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(filePath, error);
+    if (!error) readSize = size;
+    readStream(file);
+}
+
+bool NdjsonFileHandler::readStream(std::istream& input) {
+    clearEntries();
+    std::string line;
+    for (size_t lineNumber = 1; std::getline(input, line); ++lineNumber) {
+        if (!parseLine(line, lineNumber)) break;
+    }
+    return true;
+}
+
+bool NdjsonFileHandler::readContents(std::string contents) {
+    return readBuffer(contents);
+}
+
+bool NdjsonFileHandler::readBuffer(std::string_view data) {
+    clearEntries();
+    readSize = data.size();
+    std::string_view rest(data);
+    for (size_t lineNumber = 1; !rest.empty(); ++lineNumber) {
+        size_t end = rest.find('\n');
+        if (!parseLine(rest.substr(0, end), lineNumber)) break;
+        rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+    }
+    return true;
+}
+
+void NdjsonFileHandler::writeDocument(std::ostream& file) const {
+    for (const auto& entry : jsonData) {
+        file << entry << '\n';
+    }
+}
@@ -0,0 +1,27 @@
+#include "OutputBuffer.hpp"
+#include <cmath>
+
+OutputBuffer::OutputBuffer(std::ostream& sink, size_t capacity)
+    : sink(&sink), capacity(capacity) {
+    buffer.reserve(capacity + 64);
+}
+
+OutputBuffer::~OutputBuffer() {
+    if (sink) flush();
+}
+
+OutputBuffer& OutputBuffer::operator<<(double value) {
+    // Same spelling of the special values as the stream output used before
+    if (std::isnan(value)) return *this << std::string_view("nan");
+    if (std::isinf(value)) return *this << std::string_view(value > 0 ? "inf" : "-inf");
+
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    return *this << std::string_view(digits, static_cast<size_t>(result.ptr - digits));
+}
+
+void OutputBuffer::flush() {
+    if (!sink || buffer.empty()) return;
+    sink->write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+}
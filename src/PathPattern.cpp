@@ -0,0 +1,135 @@
+#include "PathPattern.hpp"
+#include <algorithm>
+#include <filesystem>
+
+#ifdef __linux__
+#include <fnmatch.h>
+#include <glob.h>
+#endif
+
+bool hasWildcards(const std::string& path) {
+    return path.find_first_of("*?[") != std::string::npos;
+}
+
+#ifdef __linux__
+
+bool matchesPattern(const std::string& pattern, const std::string& path) {
+    return ::fnmatch(pattern.c_str(), path.c_str(), FNM_PATHNAME) == 0;
+}
+
+std::vector<std::string> expandPattern(const std::string& pattern, bool onlyDirectories) {
+    std::vector<std::string> paths;
+    glob_t matches;
+    if (::glob(pattern.c_str(), onlyDirectories ? GLOB_ONLYDIR : 0, nullptr, &matches) == 0) {
+        paths.assign(matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+    }
+    globfree(&matches);
+    return paths;
+}
+
+#else
+
+namespace {
+
+// Matches a bracket expression at pattern against c; advances pattern past
+// it. False in valid if there is no closing ']', which makes '[' literal
+bool matchesBracket(const char*& pattern, char c, bool& valid) {
+    const char* p = pattern + 1;
+    bool negated = *p == '!' || *p == '^';
+    if (negated) ++p;
+    bool matched = false;
+    for (bool first = true; *p && (first || *p != ']'); first = false) {
+        char low = *p++;
+        char high = low;
+        if (*p == '-' && p[1] && p[1] != ']') {
+            high = p[1];
+            p += 2;
+        }
+        if (low <= c && c <= high) matched = true;
+    }
+    valid = *p == ']';
+    if (!valid) return false;
+    pattern = p + 1;
+    return matched != negated && c != '/';
+}
+
+bool matchesFrom(const char* pattern, const char* path) {
+    while (*pattern) {
+        if (*pattern == '*') {
+            while (*pattern == '*') ++pattern;
+            for (;; ++path) {
+                if (matchesFrom(pattern, path)) return true;
+                if (!*path || *path == '/') return false;
+            }
+        }
+        if (*pattern == '?') {
+            if (!*path || *path == '/') return false;
+            ++pattern;
+            ++path;
+            continue;
+        }
+        if (*pattern == '[') {
+            bool valid = false;
+            if (!*path) return false;
+            if (matchesBracket(pattern, *path, valid)) {
+                ++path;
+                continue;
+            }
+            if (valid) return false;
+        }
+        if (*pattern != *path) return false;
+        ++pattern;
+        ++path;
+    }
+    return !*path;
+}
+
+std::string joinPath(const std::string& directory, const std::string& name) {
+    if (directory.empty()) return name;
+    return directory.back() == '/' ? directory + name : directory + "/" + name;
+}
+
+} // namespace
+
+bool matchesPattern(const std::string& pattern, const std::string& path) {
+    return matchesFrom(pattern.c_str(), path.c_str());
+}
+
+std::vector<std::string> expandPattern(const std::string& pattern, bool onlyDirectories) {
+    // Expanded one path component at a time, from the root or working directory
+    std::vector<std::string> paths = {pattern.rfind('/', 0) == 0 ? "/" : ""};
+    size_t start = pattern.find_first_not_of('/');
+    while (start != std::string::npos && start < pattern.size() && !paths.empty()) {
+        size_t end = pattern.find('/', start);
+        std::string component = pattern.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        start = end == std::string::npos ? end : pattern.find_first_not_of('/', end);
+
+        std::vector<std::string> next;
+        std::error_code error;
+        for (const auto& directory : paths) {
+            if (!hasWildcards(component)) {
+                std::string path = joinPath(directory, component);
+                if (std::filesystem::exists(path, error)) next.push_back(path);
+                continue;
+            }
+            std::string listed = directory.empty() ? "." : directory;
+            for (std::filesystem::directory_iterator it(listed, error), stop; !error && it != stop; it.increment(error)) {
+                std::string name = it->path().filename().string();
+                if (name[0] == '.' && component[0] != '.') continue;
+                if (matchesPattern(component, name)) next.push_back(joinPath(directory, name));
+            }
+        }
+        paths = std::move(next);
+    }
+
+    if (onlyDirectories) {
+        paths.erase(std::remove_if(paths.begin(), paths.end(), [](const std::string& path) {
+            std::error_code error;
+            return !std::filesystem::is_directory(path, error);
+        }), paths.end());
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+#endif
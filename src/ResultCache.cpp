@@ -0,0 +1,166 @@
+#include "ResultCache.hpp"
+#include "AtomicFileWriter.hpp"
+#include "Hash.hpp"
+#include "OutputBuffer.hpp"
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+const char* header = "dataprocessor-cache 1";
+
+// Entries stored less than this after the file's modification time are
+// verified by hash, covering filesystems with coarse timestamps
+const int64_t racyNanoseconds = int64_t(2) * 1000 * 1000 * 1000;
+
+int64_t nanoseconds(std::filesystem::file_time_type time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+// Size and modification time of a file
+bool statFile(const std::string& path, uint64_t& size, int64_t& modified) {
+    std::error_code error;
+    size = std::filesystem::file_size(path, error);
+    if (error) return false;
+    modified = nanoseconds(std::filesystem::last_write_time(path, error));
+    return !error;
+}
+
+std::string absolutePath(const std::string& path) {
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(path, error);
+    return error ? path : absolute.lexically_normal().string();
+}
+
+template <typename Number>
+bool parseNumber(const std::string& text, Number& value, int base = 10) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value, base);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+} // namespace
+
+ResultCache::ResultCache(const std::string& cachePath, bool verify)
+    : cachePath(cachePath), verify(verify), changed(false) {
+    load();
+}
+
+std::string ResultCache::signatureOf(const ProcessingOptions& options) {
+    std::ostringstream text;
+    text << "statistics=" << options.statistics << ";percentiles=";
+    for (double percentile : options.percentiles) text << percentile << ',';
+    text << ";histogram=" << options.histogramDigits << ";robust=" << options.robust
+         << ";outliers=" << options.writeOutliers << ";z=" << options.zScoreThreshold
+         << ";mad=" << options.madThreshold << ";window=" << options.rollingWindow
+         << ";all_columns=" << options.allColumns << ";correlation=" << options.correlation
+         << ";distinct_ids=" << options.distinctIds << ";top_k=" << options.topK
+         << ";group_by=" << options.groupBy << ";output=" << static_cast<int>(options.output)
+         << ";incremental=" << options.incremental << ";delimiter=" << static_cast<int>(options.delimiter);
+    char digits[17];
+    auto result = std::to_chars(digits, digits + 16, hash64(text.str()), 16);
+    return std::string(digits, result.ptr);
+}
+
+void ResultCache::load() {
+    std::ifstream file(cachePath);
+    std::string line;
+    if (!file.is_open() || !std::getline(file, line) || line != header) return;
+
+    // path, signature, size, modified, recorded, hash, statistics
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields;
+        std::stringstream lineStream(line);
+        std::string field;
+        while (fields.size() < 6 && std::getline(lineStream, field, '\t')) fields.push_back(field);
+        if (fields.size() < 6) continue;
+        Entry entry;
+        entry.signature = fields[1];
+        std::getline(lineStream, entry.statistics);
+        if (parseNumber(fields[2], entry.size) && parseNumber(fields[3], entry.modified) &&
+            parseNumber(fields[4], entry.recorded) && parseNumber(fields[5], entry.hash, 16)) {
+            entries[fields[0]] = std::move(entry);
+        }
+    }
+}
+
+bool ResultCache::lookup(const std::string& path, const ProcessingOptions& options, std::string& statistics) {
+    std::string key = absolutePath(path);
+    Entry entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = entries.find(key);
+        if (found == entries.end()) return false;
+        entry = found->second;
+    }
+
+    uint64_t size = 0;
+    int64_t modified = 0;
+    if (entry.signature != signatureOf(options) || !statFile(path, size, modified) ||
+        size != entry.size || modified != entry.modified) {
+        return false;
+    }
+    // The data file stays as it was in sidecar mode; the statistics must still be there
+    std::error_code error;
+    if (options.output == OutputMode::Sidecar && !std::filesystem::exists(path + ".stats.json", error)) {
+        return false;
+    }
+
+    bool racy = entry.recorded - entry.modified < racyNanoseconds;
+    if (verify || racy) {
+        uint64_t hash = 0;
+        if (!hashFile(path, hash) || hash != entry.hash) return false;
+        if (racy) {
+            // Verified now, long enough after the modification to trust it next time
+            std::lock_guard<std::mutex> lock(mutex);
+            entries[key].recorded = nanoseconds(std::filesystem::file_time_type::clock::now());
+            changed = true;
+        }
+    }
+    statistics = std::move(entry.statistics);
+    return true;
+}
+
+void ResultCache::store(const std::string& path, const ProcessingOptions& options, std::string statistics, uint64_t writtenSize) {
+    std::string key = absolutePath(path);
+    if (key.find_first_of("\t\n") != std::string::npos) return;
+
+    Entry entry;
+    entry.signature = signatureOf(options);
+    entry.statistics = std::move(statistics);
+    if (!statFile(path, entry.size, entry.modified) || entry.size != writtenSize || !hashFile(path, entry.hash)) return;
+    uint64_t size = 0;
+    int64_t modified = 0;
+    if (!statFile(path, size, modified) || size != entry.size || modified != entry.modified) return;
+    entry.recorded = nanoseconds(std::filesystem::file_time_type::clock::now());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[key] = std::move(entry);
+    changed = true;
+}
+
+bool ResultCache::save() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!changed) return true;
+
+    AtomicFileWriter file(cachePath);
+    if (!file.isOpen()) return false;
+    {
+        OutputBuffer out(file);
+        out << std::string_view(header) << '\n';
+        for (const auto& [path, entry] : entries) {
+            out << std::string_view(path) << '\t' << std::string_view(entry.signature) << '\t' << entry.size << '\t'
+                << entry.modified << '\t' << entry.recorded << '\t';
+            char digits[17];
+            auto result = std::to_chars(digits, digits + 16, entry.hash, 16);
+            out << std::string_view(digits, static_cast<size_t>(result.ptr - digits)) << '\t'
+                << std::string_view(entry.statistics) << '\n';
+        }
+    }
+    if (!file.commit()) return false;
+    changed = false;
+    return true;
+}
@@ -0,0 +1,57 @@
+#include "RollingStatistics.hpp"
+#include <algorithm>
+#include <cmath>
+
+RollingStatistics::RollingStatistics(size_t windowSize)
+    : windowSize(std::max<size_t>(1, windowSize)), window(this->windowSize), count(0), pushed(0),
+      currentMean(0), m2(0) {}
+
+void RollingStatistics::push(double value) {
+    size_t slot = pushed % windowSize;
+
+    if (count < windowSize) {
+        // Growing window: plain Welford update
+        ++count;
+        double delta = value - currentMean;
+        currentMean += delta / count;
+        m2 += delta * (value - currentMean);
+    }
+    else {
+        // Full window: replace the oldest value in one combined update
+        double oldest = window[slot];
+        double newMean = currentMean + (value - oldest) / count;
+        m2 += (value - oldest) * (value - newMean + oldest - currentMean);
+        currentMean = newMean;
+    }
+    window[slot] = value;
+
+    // Drop values that left the window, then values the new one dominates
+    size_t position = pushed++;
+    size_t firstInWindow = position + 1 - count;
+    while (!minDeque.empty() && minDeque.front().first < firstInWindow) minDeque.pop_front();
+    while (!maxDeque.empty() && maxDeque.front().first < firstInWindow) maxDeque.pop_front();
+    while (!minDeque.empty() && minDeque.back().second >= value) minDeque.pop_back();
+    while (!maxDeque.empty() && maxDeque.back().second <= value) maxDeque.pop_back();
+    minDeque.emplace_back(position, value);
+    maxDeque.emplace_back(position, value);
+}
+
+double RollingStatistics::std_dev() const {
+    if (count == 0) return 0.0;
+    // Rounding can leave m2 marginally negative for constant windows
+    return std::sqrt(std::max(0.0, m2 / count));
+}
+
+std::vector<RollingValues> calculateRollingStatistics(const std::vector<double>& values, size_t windowSize) {
+    std::vector<RollingValues> results;
+    results.reserve(values.size());
+
+    // A window longer than the input never fills, so it is only as long as
+    // the input, whatever size was asked for
+    RollingStatistics rolling(std::min(windowSize, values.size()));
+    for (double value : values) {
+        rolling.push(value);
+        results.push_back({rolling.mean(), rolling.std_dev(), rolling.min(), rolling.max()});
+    }
+    return results;
+}
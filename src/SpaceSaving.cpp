@@ -0,0 +1,121 @@
+#include "SpaceSaving.hpp"
+#include <algorithm>
+
+SpaceSaving::SpaceSaving(size_t capacity)
+    : capacity(std::max<size_t>(1, capacity)), index(this->capacity) {}
+
+void SpaceSaving::add(std::string_view key, uint64_t weight) {
+    if (const size_t* slot = index.find(key)) {
+        counters[*slot].count += weight;
+        siftDown(heapPosition[*slot]);
+        return;
+    }
+
+    if (counters.size() < capacity) {
+        size_t slot = counters.size();
+        counters.push_back({std::string(key), weight, 0});
+        heap.push_back(slot);
+        heapPosition.push_back(heap.size() - 1);
+        index[key] = slot;
+        siftUp(heap.size() - 1);
+        return;
+    }
+
+    // Evict the smallest counter; the new key inherits its count as error
+    size_t slot = heap.front();
+    Counter& counter = counters[slot];
+    index.erase(std::string_view(counter.key));
+    counter.key = std::string(key);
+    counter.error = counter.count;
+    counter.count += weight;
+    index[key] = slot;
+    siftDown(0);
+}
+
+void SpaceSaving::merge(const SpaceSaving& other) {
+    uint64_t ownMinimum = minimumCount();
+    uint64_t otherMinimum = other.minimumCount();
+
+    std::vector<Counter> entries;
+    entries.reserve(counters.size() + other.counters.size());
+    for (const Counter& counter : counters) {
+        const size_t* slot = other.index.find(std::string_view(counter.key));
+        if (slot) {
+            const Counter& match = other.counters[*slot];
+            entries.push_back({counter.key, counter.count + match.count, counter.error + match.error});
+        }
+        else {
+            entries.push_back({counter.key, counter.count + otherMinimum, counter.error + otherMinimum});
+        }
+    }
+    for (const Counter& counter : other.counters) {
+        if (!index.find(std::string_view(counter.key))) {
+            entries.push_back({counter.key, counter.count + ownMinimum, counter.error + ownMinimum});
+        }
+    }
+    rebuild(std::move(entries));
+}
+
+std::vector<SpaceSaving::Counter> SpaceSaving::top(size_t k) const {
+    std::vector<Counter> result = counters;
+    std::sort(result.begin(), result.end(), [](const Counter& a, const Counter& b) {
+        return a.count != b.count ? a.count > b.count : a.key < b.key;
+    });
+    if (result.size() > k) result.resize(k);
+    return result;
+}
+
+uint64_t SpaceSaving::minimumCount() const {
+    // Until the summary is full, every key seen so far is monitored exactly
+    return counters.size() < capacity ? 0 : counters[heap.front()].count;
+}
+
+void SpaceSaving::siftUp(size_t position) {
+    while (position > 0) {
+        size_t parent = (position - 1) / 2;
+        if (counters[heap[parent]].count <= counters[heap[position]].count) break;
+        swapHeap(parent, position);
+        position = parent;
+    }
+}
+
+void SpaceSaving::siftDown(size_t position) {
+    for (;;) {
+        size_t smallest = position;
+        size_t left = 2 * position + 1;
+        size_t right = left + 1;
+        if (left < heap.size() && counters[heap[left]].count < counters[heap[smallest]].count) smallest = left;
+        if (right < heap.size() && counters[heap[right]].count < counters[heap[smallest]].count) smallest = right;
+        if (smallest == position) break;
+        swapHeap(position, smallest);
+        position = smallest;
+    }
+}
+
+void SpaceSaving::swapHeap(size_t a, size_t b) {
+    std::swap(heap[a], heap[b]);
+    heapPosition[heap[a]] = a;
+    heapPosition[heap[b]] = b;
+}
+
+void SpaceSaving::rebuild(std::vector<Counter> entries) {
+    // Keep the capacity largest counters
+    std::sort(entries.begin(), entries.end(), [](const Counter& a, const Counter& b) {
+        return a.count > b.count;
+    });
+    if (entries.size() > capacity) entries.resize(capacity);
+
+    counters = std::move(entries);
+    index.clear();
+    heap.clear();
+    heapPosition.clear();
+    // Counters sorted by decreasing count become a valid min-heap when reversed
+    for (size_t slot = 0; slot < counters.size(); ++slot) {
+        index[std::string_view(counters[slot].key)] = slot;
+        heap.push_back(counters.size() - 1 - slot);
+    }
+    heapPosition.resize(counters.size());
+    for (size_t position = 0; position < heap.size(); ++position) {
+        heapPosition[heap[position]] = position;
+    }
+}
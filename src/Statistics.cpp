@@ -0,0 +1,100 @@
+#include "Statistics.hpp"
+#include "StatisticSet.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+// Places the order statistics for ranks [firstRank, lastRank) into position.
+// first points at the element whose global rank is offset.
+void multiSelect(std::vector<double>::iterator first, std::vector<double>::iterator last,
+                 std::vector<size_t>::const_iterator firstRank, std::vector<size_t>::const_iterator lastRank,
+                 size_t offset) {
+    if (firstRank == lastRank || first == last) return;
+
+    // Select the middle rank, then split the remaining ranks around it
+    auto midRank = firstRank + (lastRank - firstRank) / 2;
+    auto nth = first + (*midRank - offset);
+    std::nth_element(first, nth, last);
+
+    multiSelect(first, nth, firstRank, midRank, offset);
+    multiSelect(nth + 1, last, midRank + 1, lastRank, *midRank + 1);
+}
+
+using StatisticsFunction = Statistics (*)(const std::vector<double>&, const ProcessingOptions&);
+
+template <size_t... Masks>
+constexpr std::array<StatisticsFunction, sizeof...(Masks)> makeStatisticsFunctions(std::index_sequence<Masks...>) {
+    return {&computeStatistics<Masks>...};
+}
+
+// One specialisation of computeStatistics for every combination of flags
+const auto statisticsFunctions = makeStatisticsFunctions(std::make_index_sequence<32>());
+
+} // namespace
+
+void selectOrderStatistics(std::vector<double>& values, std::vector<size_t> ranks) {
+    std::sort(ranks.begin(), ranks.end());
+    ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+    ranks.erase(std::lower_bound(ranks.begin(), ranks.end(), values.size()), ranks.end());
+
+    multiSelect(values.begin(), values.end(), ranks.begin(), ranks.end(), 0);
+}
+
+std::vector<double> calculatePercentiles(std::vector<double>& values, const std::vector<double>& percentiles) {
+    std::vector<double> results;
+    if (values.empty()) {
+        results.assign(percentiles.size(), 0.0);
+        return results;
+    }
+
+    // Every percentile needs the two ranks around its fractional position
+    std::vector<size_t> ranks;
+    for (double p : percentiles) {
+        double position = p / 100.0 * (values.size() - 1);
+        ranks.push_back(static_cast<size_t>(std::floor(position)));
+        ranks.push_back(static_cast<size_t>(std::ceil(position)));
+    }
+    selectOrderStatistics(values, ranks);
+
+    for (double p : percentiles) {
+        double position = p / 100.0 * (values.size() - 1);
+        size_t lower = static_cast<size_t>(std::floor(position));
+        size_t upper = static_cast<size_t>(std::ceil(position));
+        double fraction = position - lower;
+        results.push_back(values[lower] + fraction * (values[upper] - values[lower]));
+    }
+    return results;
+}
+
+Statistics calculateStatistics(const std::vector<double>& values, const ProcessingOptions& options) {
+    // Map the runtime selection onto one of the pre-instantiated statistic sets
+    unsigned mask = options.statistics & StatDefault;
+    if (!options.percentiles.empty()) mask |= StatPercentiles;
+    if (options.robustStatistics()) mask |= StatRobust;
+    return statisticsFunctions[mask](values, options);
+}
+
+void countOutliers(const std::vector<double>& values, const ProcessingOptions& options, Statistics& stats) {
+    // 0.6745 scales the MAD to the standard deviation of a normal distribution
+    const double madScale = 0.6745;
+    for (size_t row = 0; row < values.size(); ++row) {
+        double value = values[row];
+        bool zScoreOutlier = stats.std_dev > 0 && std::fabs(value - stats.mean) / stats.std_dev > options.zScoreThreshold;
+        bool madOutlier = stats.mad > 0 && madScale * std::fabs(value - stats.median) / stats.mad > options.madThreshold;
+        if (zScoreOutlier) ++stats.zScoreOutliers;
+        if (madOutlier) ++stats.madOutliers;
+        if ((zScoreOutlier || madOutlier) && options.writeOutliers) {
+            stats.outliers.push_back({row, value});
+        }
+    }
+}
+
+std::string percentileLabel(double percentile) {
+    std::ostringstream label;
+    label << "p" << percentile;
+    return label.str();
+}
@@ -0,0 +1,79 @@
+#include "StatisticsJson.hpp"
+#include "AtomicFileWriter.hpp"
+#include <charconv>
+#include <iomanip>
+#include <set>
+
+namespace {
+
+bool isStatisticsKey(const std::string& key) {
+    static const std::set<std::string> names = {"mean", "median", "std_dev", "mad", "z_outliers", "mad_outliers",
+                                                "histogram", "distinct_ids", "top_ids"};
+    if (names.count(key)) return true;
+    // Percentiles: "p" and a number
+    if (key.size() < 2 || key[0] != 'p') return false;
+    double percentile = 0;
+    auto [end, error] = std::from_chars(key.data() + 1, key.data() + key.size(), percentile);
+    return error == std::errc() && end == key.data() + key.size();
+}
+
+bool hasOnlyStatistics(const nlohmann::json& entry) {
+    if (!entry.is_object() || entry.empty()) return false;
+    for (const auto& [key, value] : entry.items()) {
+        if (!isStatisticsKey(key)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+nlohmann::json statisticsEntry(const Statistics& stats, const ProcessingOptions& options) {
+    nlohmann::json entry = nlohmann::json::object();
+    if (options.statistics & StatMean) entry["mean"] = stats.mean;
+    if (options.statistics & StatMedian) entry["median"] = stats.median;
+    if (options.statistics & StatStdDev) entry["std_dev"] = stats.std_dev;
+    for (size_t i = 0; i < stats.percentiles.size(); ++i) {
+        entry[percentileLabel(stats.percentiles[i])] = stats.percentileValues[i];
+    }
+    if (options.robustStatistics()) {
+        entry["mad"] = stats.mad;
+        entry["z_outliers"] = stats.zScoreOutliers;
+        entry["mad_outliers"] = stats.madOutliers;
+    }
+    if (stats.histogram) {
+        entry["histogram"] = stats.histogram->serialize();
+    }
+    return entry;
+}
+
+void addIdStatistics(nlohmann::json& entry, const std::optional<HyperLogLog>& idSketch,
+                     const std::optional<SpaceSaving>& topIds, const ProcessingOptions& options, bool jsonIds) {
+    if (idSketch) {
+        entry["distinct_ids"] = idSketch->estimate();
+    }
+    if (topIds) {
+        nlohmann::json top = nlohmann::json::array();
+        for (const auto& counter : topIds->top(options.topK)) {
+            nlohmann::json id = jsonIds ? nlohmann::json::parse(counter.key) : nlohmann::json(counter.key);
+            top.push_back({{"id", id}, {"count", counter.count}});
+        }
+        entry["top_ids"] = top;
+    }
+}
+
+bool isStatisticsEntry(const nlohmann::json& entry) {
+    if (!entry.is_object() || entry.empty() || entry.contains("id") || entry.contains("value")) return false;
+    if (hasOnlyStatistics(entry)) return true;
+    for (const auto& [key, value] : entry.items()) {
+        if (key == "distinct_ids" || key == "top_ids") continue;
+        if (!hasOnlyStatistics(value)) return false;
+    }
+    return true;
+}
+
+bool writeStatisticsSidecar(const std::string& dataPath, const nlohmann::json& statsEntry) {
+    AtomicFileWriter file(dataPath + ".stats.json");
+    if (!file.isOpen()) return false;
+    file << std::setw(4) << statsEntry;
+    return file.commit();
+}
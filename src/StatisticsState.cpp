@@ -0,0 +1,110 @@
+#include "StatisticsState.hpp"
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+StatisticsState::StatisticsState(const ProcessingOptions& options)
+    : signature(signatureOf(options)) {
+    if (options.histogramDigits > 0) {
+        histogram.emplace(options.histogramDigits);
+    }
+    if (options.distinctIds) {
+        idSketch.emplace();
+    }
+}
+
+void StatisticsState::add(const std::vector<double>& values) {
+    if (values.empty()) return;
+
+    // Summarise the batch on its own, then merge it into the running state
+    double batchMean = 0.0;
+    for (double value : values) {
+        batchMean += value;
+        if (histogram) histogram->record(value);
+    }
+    batchMean /= values.size();
+    double batchM2 = 0.0;
+    for (double value : values) {
+        batchM2 += (value - batchMean) * (value - batchMean);
+    }
+
+    double total = static_cast<double>(count + values.size());
+    double delta = batchMean - mean;
+    mean += delta * values.size() / total;
+    m2 += batchM2 + delta * delta * count * values.size() / total;
+    count += values.size();
+}
+
+Statistics StatisticsState::statistics() const {
+    Statistics stats;
+    if (count > 0) {
+        stats.mean = mean;
+        stats.std_dev = std::sqrt(m2 / count);
+    }
+    stats.histogram = histogram;
+    return stats;
+}
+
+bool StatisticsState::needsValues(const ProcessingOptions& options) {
+    return (options.statistics & StatMedian) != 0 || !options.percentiles.empty();
+}
+
+std::string StatisticsState::signatureOf(const ProcessingOptions& options) {
+    std::ostringstream text;
+    text << "statistics=" << options.statistics << ";histogram=" << options.histogramDigits << ";distinct_ids=" << options.distinctIds
+         << ";output=" << static_cast<int>(options.output);
+    return text.str();
+}
+
+std::string StatisticsState::serialize() const {
+    // One "key value" line per field; doubles keep every significant digit
+    std::ostringstream file;
+    file << std::setprecision(17);
+    file << "signature " << signature << "\n";
+    file << "data_end " << dataEnd << "\n";
+    file << "footer_size " << footerSize << "\n";
+    file << "footer_hash " << footerHash << "\n";
+    file << "count " << count << "\n";
+    file << "mean " << mean << "\n";
+    file << "m2 " << m2 << "\n";
+    if (histogram) file << "histogram " << histogram->serialize() << "\n";
+    if (idSketch) file << "id_sketch " << idSketch->serialize() << "\n";
+    return file.str();
+}
+
+bool StatisticsState::load(const std::string& statePath, StatisticsState& state) {
+    std::ifstream file(statePath);
+    if (!file.is_open()) return false;
+
+    StatisticsState result;
+    std::string line;
+    try {
+        while (std::getline(file, line)) {
+            size_t space = line.find(' ');
+            if (space == std::string::npos) return false;
+            std::string key = line.substr(0, space);
+            std::string value = line.substr(space + 1);
+            if (key == "signature") result.signature = value;
+            else if (key == "data_end") result.dataEnd = std::stoull(value);
+            else if (key == "footer_size") result.footerSize = std::stoull(value);
+            else if (key == "footer_hash") result.footerHash = std::stoull(value);
+            else if (key == "count") result.count = std::stoull(value);
+            else if (key == "mean") result.mean = std::stod(value);
+            else if (key == "m2") result.m2 = std::stod(value);
+            else if (key == "histogram") {
+                result.histogram.emplace();
+                if (!Histogram::deserialize(value, *result.histogram)) return false;
+            }
+            else if (key == "id_sketch") {
+                result.idSketch.emplace();
+                if (!HyperLogLog::deserialize(value, *result.idSketch)) return false;
+            }
+        }
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    state = result;
+    return true;
+}
@@ -0,0 +1,115 @@
+#include "TaskScheduler.hpp"
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace {
+
+// Scheduler and deque of the worker running on this thread, if any
+thread_local const TaskScheduler* currentScheduler = nullptr;
+thread_local size_t currentWorker = 0;
+
+} // namespace
+
+TaskScheduler::TaskScheduler(unsigned threads)
+    : queued(0), pending(0), nextQueue(0), stopping(false) {
+    size_t count = std::max(1u, threads);
+    for (size_t i = 0; i < count; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < count; ++i) {
+        workers.emplace_back([this, i]() { run(i); });
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    taskQueued.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void TaskScheduler::submit(Task task) {
+    size_t target = currentScheduler == this ? currentWorker : nextQueue++ % queues.size();
+    ++pending;
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+        // Counted under the lock the idle workers wait on, so none misses it
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++queued;
+    }
+    taskQueued.notify_one();
+}
+
+size_t TaskScheduler::workerIndex() const {
+    return currentScheduler == this ? currentWorker : workers.size();
+}
+
+void TaskScheduler::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this]() { return pending == 0; });
+}
+
+bool TaskScheduler::take(size_t self, Task& task) {
+    {
+        std::lock_guard<std::mutex> lock(queues[self]->mutex);
+        if (!queues[self]->tasks.empty()) {
+            task = std::move(queues[self]->tasks.back());
+            queues[self]->tasks.pop_back();
+            --queued;
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); ++k) {
+        Queue& victim = *queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::run(size_t self) {
+    currentScheduler = this;
+    currentWorker = self;
+
+    Task task;
+    while (true) {
+        if (take(self, task)) {
+            try {
+                task();
+            }
+            catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                errors.push_back(std::string("Task failed: ") + e.what());
+            }
+            task = nullptr;
+            if (--pending == 0) {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        taskQueued.wait(lock, [this]() { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
+
+std::vector<std::string> TaskScheduler::takeErrors() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return std::exchange(errors, {});
+}
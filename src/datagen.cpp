@@ -0,0 +1,153 @@
+// Writes reproducible random data files for tests and benchmarks: the same
+// options and seed always produce the same file, whatever the thread count.
+//
+// Usage: datagen [options] <file_path>
+
+#include "CommandLine.hpp"
+#include "DataGenerator.hpp"
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <string>
+
+namespace {
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--format=csv|json|ndjson] [--rows=N] [--seed=S] [--ids=uniform|zipf[:exponent]] [--id-count=N] [--values=uniform[:min:max]|normal[:mean:std_dev]] [--nan-rate=F] [--bad-rate=F] [--delimiter=C|tab] [--chunk-rows=N] [--threads=N] <file_path>" << std::endl;
+}
+
+// Removes the text up to the next ':' (or all of it) from text and returns it
+std::string nextField(std::string& text) {
+    size_t colon = text.find(':');
+    std::string field = text.substr(0, colon);
+    text = colon == std::string::npos ? "" : text.substr(colon + 1);
+    return field;
+}
+
+bool parseArgument(const std::string& arg, GeneratorOptions& options, std::string& path) {
+    auto valueOf = [&arg](const char* name) { return arg.substr(std::string(name).size()); };
+    const uint64_t anyCount = std::numeric_limits<uint64_t>::max();
+
+    if (arg.rfind("--format=", 0) == 0) {
+        std::string format = valueOf("--format=");
+        if (format == "csv") options.format = FileFormat::Csv;
+        else if (format == "json") options.format = FileFormat::Json;
+        else if (format == "ndjson") options.format = FileFormat::Ndjson;
+        else return false;
+    }
+    else if (arg.rfind("--rows=", 0) == 0) {
+        return parseCount(valueOf("--rows="), anyCount, options.rows);
+    }
+    else if (arg.rfind("--seed=", 0) == 0) {
+        return parseCount(valueOf("--seed="), anyCount, options.seed);
+    }
+    else if (arg.rfind("--ids=", 0) == 0) {
+        std::string spec = valueOf("--ids=");
+        std::string name = nextField(spec);
+        if (name == "uniform" && spec.empty()) {
+            options.ids = IdDistribution::Uniform;
+        }
+        else if (name == "zipf") {
+            options.ids = IdDistribution::Zipf;
+            if (!spec.empty()) options.zipfExponent = std::stod(spec);
+            if (!(options.zipfExponent > 0)) return false;
+        }
+        else {
+            return false;
+        }
+    }
+    else if (arg.rfind("--id-count=", 0) == 0) {
+        return parseCount(valueOf("--id-count="), anyCount, options.idCount) && options.idCount > 0;
+    }
+    else if (arg.rfind("--values=", 0) == 0) {
+        std::string spec = valueOf("--values=");
+        std::string name = nextField(spec);
+        if (name == "uniform") {
+            options.values = ValueDistribution::Uniform;
+            if (!spec.empty()) {
+                options.minValue = std::stod(nextField(spec));
+                options.maxValue = std::stod(nextField(spec));
+            }
+        }
+        else if (name == "normal") {
+            options.values = ValueDistribution::Normal;
+            if (!spec.empty()) {
+                options.mean = std::stod(nextField(spec));
+                options.stdDev = std::stod(nextField(spec));
+            }
+        }
+        else {
+            return false;
+        }
+    }
+    else if (arg.rfind("--nan-rate=", 0) == 0) {
+        options.nanRate = std::stod(valueOf("--nan-rate="));
+        if (options.nanRate < 0 || options.nanRate > 1) return false;
+    }
+    else if (arg.rfind("--bad-rate=", 0) == 0) {
+        options.badRate = std::stod(valueOf("--bad-rate="));
+        if (options.badRate < 0 || options.badRate > 1) return false;
+    }
+    else if (arg.rfind("--delimiter=", 0) == 0) {
+        std::string delimiter = valueOf("--delimiter=");
+        if (delimiter == "tab" || delimiter == "\\t") options.delimiter = '\t';
+        else if (delimiter.size() == 1 && delimiter != "\"" && delimiter != "\n") options.delimiter = delimiter[0];
+        else return false;
+    }
+    else if (arg.rfind("--chunk-rows=", 0) == 0) {
+        return parseCount(valueOf("--chunk-rows="), anyCount, options.chunkRows) && options.chunkRows > 0;
+    }
+    else if (arg.rfind("--threads=", 0) == 0) {
+        uint64_t threads = 0;
+        if (!parseCount(valueOf("--threads="), std::numeric_limits<unsigned>::max(), threads)) return false;
+        options.threads = static_cast<unsigned>(threads);
+    }
+    else if (arg.rfind("--", 0) == 0 || !path.empty()) {
+        return false;
+    }
+    else {
+        path = arg;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    GeneratorOptions options;
+    std::string path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool valid = false;
+        try {
+            valid = parseArgument(arg, options, path);
+        }
+        catch (const std::exception&) {
+            valid = false;
+        }
+        if (!valid) {
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (path.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::string failure;
+    if (!generateDataFile(path, options, &failure)) {
+        std::cerr << failure << std::endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::error_code error;
+    uint64_t bytes = std::filesystem::file_size(path, error);
+    std::cout << "Generated " << options.rows << " rows (" << bytes / 1e6 << " MB) in " << seconds << "s: " << path << std::endl;
+    return 0;
+}
@@ -1,106 +1,360 @@
+#include "BatchProcessor.hpp"
+#include "CommandLine.hpp"
+#include "DirectoryWatcher.hpp"
 #include "FileHandlerCreator.hpp"
-#include "JsonFileHandlerCreator.hpp"
-#include "CsvFileHandler.hpp"
-#include "CsvFileHandlerCreator.hpp"
+#include "ProcessingOptions.hpp"
+#include "StatisticsState.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
 #include <string>
-#include <random>
-#include <fstream>
-#include "json.hpp"
-
-std::string getFileExtension(const std::string& filePath) {
-    size_t dotPosition = filePath.find_last_of('.');
-    if (dotPosition != std::string::npos) {
-        return filePath.substr(dotPosition+1);
+#include <map>
+
+// Set by SIGINT/SIGTERM to end the watch mode
+std::atomic<bool> stopRequested(false);
+
+void requestStop(int) {
+    stopRequested = true;
+}
+
+// Runs a batch and prints its report
+std::vector<FileResult> runBatch(const std::vector<std::string>& files, const ProcessingOptions& options, BatchResources& resources) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<FileResult> results = processBatch(files, options, resources);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const auto& error : resources.scheduler.takeErrors()) {
+        std::cerr << error << std::endl;
     }
-    return ""; // Return empty string if no extension found
+    printBatchReport(std::cout, results, seconds, resources.scheduler.threadCount());
+    return results;
 }
 
-// Function to generate a random JSON file
-void randomJsonFileGenerator(const std::string& fileName, int numOfEntries) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> idDist(1000, 9999);
-    std::uniform_real_distribution<> valueDist(1.0, 100.0);
-
-    nlohmann::json jsonData;
-    for (int i = 0; i < numOfEntries; ++i) {
-        jsonData.push_back({
-            {"id", idDist(gen)},
-            {"value", valueDist(gen)}
-        });
+// Processes the inputs, then every input file that changes, until interrupted.
+// The worker pool and read-ahead buffers are kept between the runs.
+int watchInputs(const std::vector<std::string>& inputs, const ProcessingOptions& options, std::chrono::milliseconds debounce, BatchResources& resources) {
+    DirectoryWatcher watcher(inputs);
+    auto reportWatchErrors = [&watcher]() {
+        for (const auto& error : watcher.takeErrors()) {
+            std::cerr << error << std::endl;
+        }
+    };
+    reportWatchErrors();
+    if (!watcher.isOpen()) {
+        std::cerr << "Unable to watch the inputs." << std::endl;
+        return 1;
     }
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+
+    // Every file as its task left it, sampled right after the write, so the
+    // events caused by writing the statistics do not trigger another run
+    // while a change made during the run still does
+    std::map<std::string, FileVersion> written;
 
-    std::ofstream file("../data/" + fileName);
-    if (file.is_open()) {
-        file << jsonData.dump(4);
-        file.close();
-        std::cout << "Random JSON file generated: " << fileName << std::endl;
-    } else {
-        std::cerr << "Unable to open file: " << fileName << std::endl;
+    std::vector<std::string> files = expandInputs(inputs);
+    while (!stopRequested) {
+        if (!files.empty()) {
+            for (const auto& result : runBatch(files, options, resources)) {
+                if (result.written) written[result.path] = *result.written;
+                else written.erase(result.path);
+            }
+        }
+
+        files.clear();
+        for (const auto& path : watcher.wait(debounce, stopRequested)) {
+            FileVersion version;
+            auto previous = written.find(path);
+            if (currentVersion(path, version) && (previous == written.end() || previous->second != version)) {
+                files.push_back(path);
+            }
+        }
+        reportWatchErrors();
     }
+    return 0;
 }
 
-// Function to generate a random CSV file
-void randomCsvFileGenerator(const std::string& fileName, int numOfEntries) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> idDist(1000, 9999);
-    std::uniform_real_distribution<> valueDist(1.0, 100.0);
-
-    std::ofstream file("../data/" + fileName);
-    if (file.is_open()) {
-        file << "id,value\n";
-        for (int i = 0; i < numOfEntries; ++i) {
-            file << idDist(gen) << "," << valueDist(gen) << "\n";
-        }
-        file.close();
-        std::cout << "Random CSV file generated: " << fileName << std::endl;
-    } else {
-        std::cerr << "Unable to open file: " << fileName << std::endl;
+// Parses a comma separated percentile list such as "50,90,99,99.9"
+bool parsePercentiles(const std::string& list, std::vector<double>& percentiles) {
+    std::stringstream listStream(list);
+    std::string item;
+    while (std::getline(listStream, item, ',')) {
+        try {
+            size_t parsed = 0;
+            double percentile = std::stod(item, &parsed);
+            // NaN fails every comparison, so it is rejected explicitly
+            if (parsed != item.size() || !std::isfinite(percentile) || percentile < 0.0 || percentile > 100.0) {
+                return false;
+            }
+            percentiles.push_back(percentile);
+        }
+        catch (const std::exception&) {
+            return false;
+        }
     }
+    return !percentiles.empty();
+}
+
+// Parses a comma separated statistic list such as "mean,std_dev" into StatisticFlags
+bool parseStatistics(const std::string& list, unsigned& statistics) {
+    std::stringstream listStream(list);
+    std::string item;
+    statistics = 0;
+    while (std::getline(listStream, item, ',')) {
+        if (item == "mean") statistics |= StatMean;
+        else if (item == "median") statistics |= StatMedian;
+        else if (item == "std_dev") statistics |= StatStdDev;
+        else return false;
+    }
+    return statistics != 0;
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--stats=mean,median,std_dev] [--percentiles=p1,p2,...] [--histogram[=digits]] [--robust] [--outliers] [--z-threshold=T] [--mad-threshold=T] [--window=N] [--all-columns] [--correlation] [--distinct-ids] [--top-k=K] [--group-by] [--output=rewrite|append|sidecar] [--incremental] [--pipeline] [--delimiter=C|tab] [--watch] [--debounce=MS] [--cache[=path]] [--verify-cache] [--threads=N] [--chunk-size=MiB] <file_path>..." << std::endl;
 }
 
 int main(int argc, char* argv[]) {
-    // Hardcoded calls to generate random files
-    randomJsonFileGenerator("randomData.json", 10);
-    randomCsvFileGenerator("randomData.csv", 10);
+    ProcessingOptions options;
+    std::vector<std::string> inputs; // Files, directories or glob patterns
+    bool watch = false;
+    std::string cachePath; // Result cache of batch runs, "" disables it
+    bool verifyCache = false;
+    std::chrono::milliseconds debounce(200); // Quiet time before changed files are processed
 
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <file_path>" << std::endl;
-        return 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--stats=", 0) == 0) {
+            std::string list = arg.substr(std::string("--stats=").size());
+            if (!parseStatistics(list, options.statistics)) {
+                std::cerr << "Invalid statistic list: " << list << std::endl;
+                return 1;
+            }
+        }
+        else if (arg.rfind("--percentiles=", 0) == 0) {
+            std::string list = arg.substr(std::string("--percentiles=").size());
+            if (!parsePercentiles(list, options.percentiles)) {
+                std::cerr << "Invalid percentile list: " << list << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--histogram") {
+            options.histogramDigits = 2;
+        }
+        else if (arg.rfind("--histogram=", 0) == 0) {
+            std::string digits = arg.substr(std::string("--histogram=").size());
+            if (digits.size() != 1 || digits[0] < '1' || digits[0] > '5') {
+                std::cerr << "Histogram precision must be 1-5 significant digits: " << digits << std::endl;
+                return 1;
+            }
+            options.histogramDigits = digits[0] - '0';
+        }
+        else if (arg == "--robust") {
+            options.robust = true;
+        }
+        else if (arg == "--outliers") {
+            options.writeOutliers = true;
+        }
+        else if (arg.rfind("--z-threshold=", 0) == 0 || arg.rfind("--mad-threshold=", 0) == 0) {
+            bool zScore = arg.rfind("--z-threshold=", 0) == 0;
+            std::string threshold = arg.substr(arg.find('=') + 1);
+            // The whole text must be a finite, positive number
+            double value = 0;
+            try {
+                size_t parsed = 0;
+                value = std::stod(threshold, &parsed);
+                if (parsed != threshold.size()) value = 0;
+            }
+            catch (const std::exception&) {
+                value = 0;
+            }
+            if (!std::isfinite(value) || value <= 0) {
+                std::cerr << "Invalid outlier threshold: " << threshold << std::endl;
+                return 1;
+            }
+            (zScore ? options.zScoreThreshold : options.madThreshold) = value;
+        }
+        else if (arg.rfind("--window=", 0) == 0) {
+            std::string rows = arg.substr(std::string("--window=").size());
+            uint64_t value = 0;
+            if (!parseCount(rows, std::numeric_limits<size_t>::max(), value)) {
+                std::cerr << "Invalid window size: " << rows << std::endl;
+                return 1;
+            }
+            options.rollingWindow = value;
+        }
+        else if (arg == "--all-columns") {
+            options.allColumns = true;
+        }
+        else if (arg == "--correlation") {
+            options.correlation = true;
+        }
+        else if (arg == "--distinct-ids") {
+            options.distinctIds = true;
+        }
+        else if (arg.rfind("--top-k=", 0) == 0) {
+            std::string count = arg.substr(std::string("--top-k=").size());
+            uint64_t value = 0;
+            if (!parseCount(count, std::numeric_limits<size_t>::max() / 10, value)) {
+                std::cerr << "Invalid top-k count: " << count << std::endl;
+                return 1;
+            }
+            options.topK = value;
+        }
+        else if (arg == "--group-by") {
+            options.groupBy = true;
+        }
+        else if (arg.rfind("--output=", 0) == 0) {
+            std::string mode = arg.substr(std::string("--output=").size());
+            if (mode == "rewrite") {
+                options.output = OutputMode::Rewrite;
+            }
+            else if (mode == "append") {
+                options.output = OutputMode::Append;
+            }
+            else if (mode == "sidecar") {
+                options.output = OutputMode::Sidecar;
+            }
+            else {
+                std::cerr << "Invalid output mode: " << mode << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--incremental") {
+            options.incremental = true;
+        }
+        else if (arg == "--pipeline") {
+            options.pipeline = true;
+        }
+        else if (arg.rfind("--delimiter=", 0) == 0) {
+            std::string delimiter = arg.substr(std::string("--delimiter=").size());
+            if (delimiter == "tab" || delimiter == "\\t") {
+                options.delimiter = '\t';
+            }
+            else if (delimiter.size() == 1 && delimiter != "\"" && delimiter != "\n") {
+                options.delimiter = delimiter[0];
+            }
+            else {
+                std::cerr << "Invalid delimiter: " << delimiter << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--cache") {
+            cachePath = ".dataprocessor.cache";
+        }
+        else if (arg.rfind("--cache=", 0) == 0) {
+            cachePath = arg.substr(std::string("--cache=").size());
+        }
+        else if (arg == "--verify-cache") {
+            verifyCache = true;
+        }
+        else if (arg == "--watch") {
+            watch = true;
+        }
+        else if (arg.rfind("--debounce=", 0) == 0) {
+            // A poll() timeout, so it has to fit an int
+            std::string milliseconds = arg.substr(std::string("--debounce=").size());
+            uint64_t count = 0;
+            if (!parseCount(milliseconds, std::numeric_limits<int>::max(), count)) {
+                std::cerr << "Invalid debounce time: " << milliseconds << std::endl;
+                return 1;
+            }
+            debounce = std::chrono::milliseconds(count);
+        }
+        else if (arg.rfind("--threads=", 0) == 0) {
+            std::string count = arg.substr(std::string("--threads=").size());
+            uint64_t value = 0;
+            if (!parseCount(count, std::numeric_limits<unsigned>::max(), value)) {
+                std::cerr << "Invalid thread count: " << count << std::endl;
+                return 1;
+            }
+            options.threads = static_cast<unsigned>(value);
+        }
+        else if (arg.rfind("--chunk-size=", 0) == 0) {
+            std::string size = arg.substr(std::string("--chunk-size=").size());
+            uint64_t value = 0;
+            if (!parseCount(size, std::numeric_limits<uint64_t>::max() >> 20, value)) {
+                std::cerr << "Invalid chunk size: " << size << std::endl;
+                return 1;
+            }
+            options.chunkSize = value << 20;
+        }
+        else if (arg.rfind("--", 0) != 0) {
+            inputs.push_back(arg);
+        }
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
     }
 
-    std::string filePath = argv[1]; // "../data/TestData.csv";
-    std::string extension = getFileExtension(filePath);
+    if (inputs.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (options.rollingWindow > 0 && options.output != OutputMode::Rewrite) {
+        std::cerr << "--window adds columns to the data file, which only --output=rewrite writes" << std::endl;
+        return 1;
+    }
+    // Appended files are merged into the state of the previous run
+    if (watch) {
+        options.incremental = true;
+    }
+    if (options.incremental && StatisticsState::needsValues(options)) {
+        std::cerr << "The median and percentiles cannot be merged incrementally; files are processed in full"
+                  << " (select e.g. --stats=mean,std_dev to parse only appended rows)" << std::endl;
+    }
 
-    FileHandlerCreator *creator = nullptr;
+    // Several paths, a directory or a glob pattern run as a batch
+    std::error_code error;
+    bool batch = inputs.size() > 1 || inputs[0].find_first_of("*?[") != std::string::npos ||
+                 std::filesystem::is_directory(inputs[0], error);
+    if (batch || watch) {
+        BatchResources resources(options.threadCount());
+        if (!cachePath.empty()) {
+            resources.cache = std::make_unique<ResultCache>(cachePath, verifyCache);
+        }
 
-    if(extension == "json") {
-        creator = new JsonFileHandlerCreator();
-    }
-    else if(extension == "csv") {
-        creator = new CsvFileHandlerCreator();
+        if (watch) {
+            return watchInputs(inputs, options, debounce, resources);
+        }
+        std::vector<FileResult> results = runBatch(expandInputs(inputs), options, resources);
+        bool processed = std::all_of(results.begin(), results.end(), [](const FileResult& result) {
+            return result.status == FileResult::Processed;
+        });
+        return processed ? 0 : 1;
     }
-    
+
+    std::string filePath = inputs[0];
+    std::string reason;
+    std::unique_ptr<FileHandlerCreator> creator = createFileHandlerCreator(filePath, options, &reason);
 
     if(creator) {
-        FileHandler* handler = creator->createFileHandler(filePath);
+        std::unique_ptr<FileHandler> handler = creator->createFileHandler(filePath);
         if(handler) {
             handler->readData();
             handler->process();
             handler->writeData();
-
-            delete handler;
+            if (!handler->errorMessage().empty()) {
+                std::cerr << handler->errorMessage() << std::endl;
+                return 1;
+            }
         }
         else {
             std::cerr << "Failed to create file handler.\n";
+            return 1;
         }
-        delete creator;
     }
     else {
-        std::cerr << "Unsupported file type.\n";
+        std::cerr << "Unable to process " << filePath << ": " << reason << std::endl;
+        return 1;
     }
 
     return 0;
-}
\ No newline at end of file
+}
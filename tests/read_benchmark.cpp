@@ -0,0 +1,77 @@
+// Compares the ways a batch can read many small files: one std::ifstream
+// per file (what the handlers do), the FileBatchReader pread fallback and
+// the FileBatchReader io_uring. Creates count CSV files of a few hundred
+// bytes in directory first if it does not exist yet.
+//
+// Usage: readBenchmark <directory> [count]
+
+#include "BatchProcessor.hpp"
+#include "FileBatchReader.hpp"
+#include "OutputBuffer.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void createFiles(const std::string& directory, size_t count) {
+    std::filesystem::create_directories(directory);
+    for (size_t i = 0; i < count; ++i) {
+        std::ofstream file(directory + "/" + std::to_string(i) + ".csv", std::ios::binary);
+        OutputBuffer out(file);
+        out << std::string_view("id,value\n");
+        for (size_t row = 0; row < 20; ++row) {
+            out << (i * 20 + row) << ',' << static_cast<double>((i * 7919 + row * 104729) % 100003) / 7 << '\n';
+        }
+    }
+}
+
+template <typename Read>
+void measure(const char* name, const std::vector<std::string>& files, Read read) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t bytes = read();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << files.size() / seconds << " files/s, " << bytes / seconds / 1e6 << " MB/s\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <directory> [count]" << std::endl;
+        return 1;
+    }
+    std::string directory = argv[1];
+    size_t count = argc > 2 ? std::stoul(argv[2]) : 100000;
+    if (!std::filesystem::exists(directory)) createFiles(directory, count);
+    std::vector<std::string> files = expandInputs({directory});
+
+    measure("ifstream", files, [&]() {
+        uint64_t bytes = 0;
+        for (const auto& path : files) {
+            std::ifstream file(path, std::ios::binary);
+            std::stringstream contents;
+            contents << file.rdbuf();
+            bytes += contents.str().size();
+        }
+        return bytes;
+    });
+
+    for (bool ioUring : {false, true}) {
+        FileBatchReader reader(64, ioUring);
+        if (ioUring && !reader.usesIoUring()) {
+            std::cout << "io_uring: not available\n";
+            continue;
+        }
+        measure(reader.usesIoUring() ? "io_uring" : "pread", files, [&]() {
+            uint64_t bytes = 0;
+            reader.readAll(files, [&bytes](size_t, std::string&& data, int) { bytes += data.size(); });
+            return bytes;
+        });
+    }
+    return 0;
+}
@@ -6,7 +6,35 @@
 #include "CsvFileHandler.hpp"
 #include "FileHandlerCreator.hpp"
 #include "JsonFileHandlerCreator.hpp"
+#include "NdjsonFileHandlerCreator.hpp"
 #include "CsvFileHandlerCreator.hpp"
+#include "Statistics.hpp"
+#include "Histogram.hpp"
+#include "GroupBy.hpp"
+#include "RollingStatistics.hpp"
+#include "HyperLogLog.hpp"
+#include "Hash.hpp"
+#include "SpaceSaving.hpp"
+#include "FlatHashMap.hpp"
+#include "StatisticSet.hpp"
+#include "CovarianceMatrix.hpp"
+#include "AtomicFileWriter.hpp"
+#include "OutputBuffer.hpp"
+#include "BatchProcessor.hpp"
+#include "TaskScheduler.hpp"
+#include "BoundedQueue.hpp"
+#include "FileBatchReader.hpp"
+#include "DirectoryWatcher.hpp"
+#include "ResultCache.hpp"
+#include "FileSniffer.hpp"
+#include "DataGenerator.hpp"
+#include "DataProcessorCore.hpp"
+#include <cmath>
+#include <filesystem>
+#include <map>
+#include <algorithm>
+#include <random>
+#include <sstream>
 
 class FileHandlerTest : public ::testing::Test {
 protected:
@@ -55,12 +83,14 @@ protected:
         std::remove("../data/InvalidFormatData.csv");
         std::remove("../data/SingleEntryCsvData.csv");
         std::remove("../data/SingleEntryJsonData.json");
+        std::remove("../data/GoogleTestData.csv.state");
+        std::remove("../data/SingleEntryCsvData.csv.state");
     }
 };
 
 TEST_F(FileHandlerTest, JsonFileHandlerProcess) {
     FileHandlerCreator* creator = new JsonFileHandlerCreator();
-    FileHandler* handler = creator->createFileHandler("../data/GoogleTestData.json");
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/GoogleTestData.json");
     handler->readData();
     handler->process();
     handler->writeData();
@@ -75,14 +105,44 @@ TEST_F(FileHandlerTest, JsonFileHandlerProcess) {
     EXPECT_NEAR(jsonData.back()["median"].get<double>(), 25.0, 1e-5);
     EXPECT_NEAR(jsonData.back()["std_dev"].get<double>(), 11.1803, 1e-4);
 
-    delete handler;
     delete creator;
 }
 
+TEST_F(FileHandlerTest, JsonRerunReplacesStatisticsEntry) {
+    ProcessingOptions options;
+    options.percentiles = {90};
+    std::ofstream("../data/GoogleTestData.ndjson") << "{\"id\": 1, \"value\": 10}\n{\"id\": 2, \"value\": 30}\n";
+    for (const std::string path : {"../data/GoogleTestData.json", "../data/GoogleTestData.ndjson"}) {
+        std::string first;
+        for (int run = 0; run < 2; ++run) {
+            std::unique_ptr<FileHandler> handler = path.ends_with(".ndjson")
+                ? NdjsonFileHandlerCreator(options).createFileHandler(path)
+                : JsonFileHandlerCreator(options).createFileHandler(path);
+            handler->readData();
+            handler->process();
+            EXPECT_TRUE(handler->succeeded()) << path << ": " << handler->errorMessage();
+            handler->writeData();
+            std::ifstream file(path);
+            std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (run == 0) first = content;
+            else EXPECT_EQ(content, first) << path;
+        }
+    }
+    std::remove("../data/GoogleTestData.ndjson");
+
+    // An entry without a value is invalid data, not a crash
+    std::ofstream("../data/GoogleTestData.json") << R"([{"id": 1, "value": 10}, {"id": 2}])";
+    JsonFileHandler handler("../data/GoogleTestData.json");
+    handler.readData();
+    handler.process();
+    EXPECT_FALSE(handler.succeeded());
+    EXPECT_NE(handler.errorMessage().find("Missing value"), std::string::npos);
+}
+
 
 TEST_F(FileHandlerTest, CsvFileHandlerProcess) {
     FileHandlerCreator* creator = new CsvFileHandlerCreator();
-    FileHandler* handler = creator->createFileHandler("../data/GoogleTestData.csv");
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/GoogleTestData.csv");
     handler->readData();
     handler->process();
     handler->writeData();
@@ -96,17 +156,16 @@ TEST_F(FileHandlerTest, CsvFileHandlerProcess) {
     file.close();
 
     // Verify that statistics are correctly written to the file
-    EXPECT_EQ(lines.back(), "std_dev,11.1803");
+    EXPECT_EQ(lines.back(), "std_dev,11.180339887498949");
     EXPECT_EQ(lines[lines.size() - 2], "median,25");
     EXPECT_EQ(lines[lines.size() - 3], "mean,25");
 
-    delete handler;
     delete creator;
 }
 
 TEST_F(FileHandlerTest, SingleEntryCsvFile) {
     FileHandlerCreator* creator = new CsvFileHandlerCreator();
-    FileHandler* handler = creator->createFileHandler("../data/SingleEntryCsvData.csv");
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/SingleEntryCsvData.csv");
     handler->readData();
     handler->process();
     handler->writeData();
@@ -123,13 +182,12 @@ TEST_F(FileHandlerTest, SingleEntryCsvFile) {
     EXPECT_EQ(lines[lines.size() - 2], "median,50");
     EXPECT_EQ(lines[lines.size() - 3], "mean,50");
 
-    delete handler;
     delete creator;
 }
 
 TEST_F(FileHandlerTest, SingleEntryJsonFile) {
     FileHandlerCreator* creator = new JsonFileHandlerCreator();
-    FileHandler* handler = creator->createFileHandler("../data/SingleEntryJsonData.json");
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/SingleEntryJsonData.json");
     handler->readData();
     handler->process();
     handler->writeData();
@@ -146,7 +204,7 @@ TEST_F(FileHandlerTest, SingleEntryJsonFile) {
 
 TEST_F(FileHandlerTest, EmptyJsonFile) {
     FileHandlerCreator* creator = new JsonFileHandlerCreator();
-    FileHandler* handler = creator->createFileHandler("../data/EmptyData.json");
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/EmptyData.json");
     handler->readData();
     handler->process();
     handler->writeData();
@@ -159,13 +217,12 @@ TEST_F(FileHandlerTest, EmptyJsonFile) {
     // Check that no statistics were added
     EXPECT_EQ(jsonData.size(), 0);
 
-    delete handler;
     delete creator;
 }
 
 TEST_F(FileHandlerTest, EmptyCsvFile) {
     FileHandlerCreator* creator = new CsvFileHandlerCreator();
-    FileHandler* handler = creator->createFileHandler("../data/EmptyData.csv");
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/EmptyData.csv");
     handler->readData();
     handler->process();
     handler->writeData();
@@ -181,13 +238,12 @@ TEST_F(FileHandlerTest, EmptyCsvFile) {
     // Check that no statistics were added
     EXPECT_EQ(lines.size(), 0);
 
-    delete handler;
     delete creator;
 }
 
 TEST_F(FileHandlerTest, InvalidJsonFormat) {
     FileHandlerCreator* creator = new JsonFileHandlerCreator();
-    FileHandler* handler = creator->createFileHandler("../data/InvalidFormatData.json");
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/InvalidFormatData.json");
     handler->readData();
     handler->process();
     handler->writeData();
@@ -200,13 +256,12 @@ TEST_F(FileHandlerTest, InvalidJsonFormat) {
     // Check that no statistics were added due to invalid value
     EXPECT_EQ(jsonData.size(), 4); // Only the original invalid entries
 
-    delete handler;
     delete creator;
 }
 
 TEST_F(FileHandlerTest, InvalidCsvFormat) {
     FileHandlerCreator* creator = new CsvFileHandlerCreator();
-    FileHandler* handler = creator->createFileHandler("../data/InvalidFormatData.csv");
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/InvalidFormatData.csv");
     handler->readData();
     handler->process();
     handler->writeData();
@@ -226,11 +281,1483 @@ TEST_F(FileHandlerTest, InvalidCsvFormat) {
     EXPECT_EQ(lines[3], "56789,NaN"); // Ensure another invalid line is present
     EXPECT_EQ(lines[4], "67890,40"); // Ensure last valid line is present
 
-    delete handler;
     delete creator;
 }
 
+TEST_F(FileHandlerTest, CsvFileHandlerPercentiles) {
+    ProcessingOptions options;
+    options.percentiles = {50, 90, 99.9};
+    FileHandlerCreator* creator = new CsvFileHandlerCreator(options);
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/GoogleTestData.csv");
+    handler->readData();
+    handler->process();
+    handler->writeData();
+
+    std::ifstream file("../data/GoogleTestData.csv");
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    file.close();
+
+    // Percentile rows follow the std_dev row in the requested order
+    EXPECT_EQ(lines.back(), "p99.9,39.97");
+    EXPECT_EQ(lines[lines.size() - 2], "p90,37");
+    EXPECT_EQ(lines[lines.size() - 3], "p50,25");
+    EXPECT_EQ(lines[lines.size() - 4], "std_dev,11.180339887498949");
+
+    delete creator;
+}
+
+TEST_F(FileHandlerTest, JsonFileHandlerPercentiles) {
+    ProcessingOptions options;
+    options.percentiles = {0, 90, 100};
+    FileHandlerCreator* creator = new JsonFileHandlerCreator(options);
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/GoogleTestData.json");
+    handler->readData();
+    handler->process();
+    handler->writeData();
+
+    std::ifstream file("../data/GoogleTestData.json");
+    nlohmann::json jsonData;
+    file >> jsonData;
+    file.close();
+
+    EXPECT_NEAR(jsonData.back()["p0"].get<double>(), 10.0, 1e-9);
+    EXPECT_NEAR(jsonData.back()["p90"].get<double>(), 37.0, 1e-9);
+    EXPECT_NEAR(jsonData.back()["p100"].get<double>(), 40.0, 1e-9);
+    EXPECT_NEAR(jsonData.back()["median"].get<double>(), 25.0, 1e-9);
+
+    delete creator;
+}
+
+TEST(StatisticsTest, SelectOrderStatisticsMatchesSort) {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> valueDist(-1000.0, 1000.0);
+    std::vector<double> values(10007);
+    for (double& value : values) {
+        value = valueDist(gen);
+    }
+    std::vector<double> sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<size_t> ranks = {0, 1, 5003, 5003, 9006, 9906, 9996, 10006};
+    selectOrderStatistics(values, ranks);
+
+    for (size_t rank : ranks) {
+        EXPECT_EQ(values[rank], sorted[rank]);
+    }
+}
+
+TEST_F(FileHandlerTest, CsvFileHandlerHistogram) {
+    ProcessingOptions options;
+    options.histogramDigits = 2;
+    FileHandlerCreator* creator = new CsvFileHandlerCreator(options);
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/GoogleTestData.csv");
+    handler->readData();
+    handler->process();
+    handler->writeData();
+
+    std::ifstream file("../data/GoogleTestData.csv");
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    file.close();
+
+    ASSERT_EQ(lines.back().rfind("histogram,", 0), 0u);
+    Histogram histogram;
+    ASSERT_TRUE(Histogram::deserialize(lines.back().substr(10), histogram));
+    EXPECT_EQ(histogram.totalCount(), 4u);
+    EXPECT_NEAR(histogram.valueAtPercentile(100), 40.0, 40.0 * 0.01);
+
+    delete creator;
+}
+
+TEST(HistogramTest, PercentilesWithinPrecision) {
+    Histogram histogram(3);
+    for (int i = 1; i <= 100000; ++i) {
+        histogram.record(i * 0.01);
+    }
+    histogram.record(0.0);
+    histogram.record(-5.0);
+
+    EXPECT_EQ(histogram.totalCount(), 100002u);
+    EXPECT_NEAR(histogram.valueAtPercentile(50), 500.0, 500.0 * 1e-3);
+    EXPECT_NEAR(histogram.valueAtPercentile(99), 990.0, 990.0 * 1e-3);
+    EXPECT_NEAR(histogram.valueAtPercentile(0), -5.0, 5.0 * 1e-3);
+}
+
+TEST(HistogramTest, WideRangeAtFullPrecision) {
+    // Hundreds of powers of two apart; dense buckets would need gigabytes
+    Histogram histogram(5);
+    for (double value : {1e-300, 1.0, 1e300, -1e200}) {
+        histogram.record(value);
+    }
+
+    EXPECT_EQ(histogram.totalCount(), 4u);
+    EXPECT_NEAR(histogram.valueAtPercentile(0), -1e200, 1e200 * 1e-5);
+    EXPECT_NEAR(histogram.valueAtPercentile(50), 1e-300, 1e-300 * 1e-5);
+    EXPECT_NEAR(histogram.valueAtPercentile(75), 1.0, 1e-5);
+    EXPECT_NEAR(histogram.valueAtPercentile(100), 1e300, 1e300 * 1e-5);
+
+    Histogram restored;
+    ASSERT_TRUE(Histogram::deserialize(histogram.serialize(), restored));
+    EXPECT_EQ(restored.serialize(), histogram.serialize());
+}
+
+TEST(HistogramTest, MergeAndSerializeRoundTrip) {
+    Histogram first(2);
+    Histogram second(2);
+    Histogram combined(2);
+    for (int i = 0; i < 1000; ++i) {
+        double value = (i % 2 ? 1.0 : -1.0) * (i * 3.7 + 0.001);
+        (i < 500 ? first : second).record(value);
+        combined.record(value);
+    }
+
+    ASSERT_TRUE(first.merge(second));
+    EXPECT_EQ(first.serialize(), combined.serialize());
+    EXPECT_FALSE(first.merge(Histogram(3)));
+
+    Histogram restored;
+    ASSERT_TRUE(Histogram::deserialize(combined.serialize(), restored));
+    EXPECT_EQ(restored.serialize(), combined.serialize());
+    EXPECT_FALSE(Histogram::deserialize("not a histogram", restored));
+}
+
+TEST_F(FileHandlerTest, CsvFileHandlerGroupBy) {
+    std::ofstream csvFile("../data/GroupByData.csv");
+    csvFile << "id,value\n7,10\n3,20\n7,30\n5,5\n3,40\n";
+    csvFile.close();
+
+    ProcessingOptions options;
+    options.groupBy = true;
+    FileHandlerCreator* creator = new CsvFileHandlerCreator(options);
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/GroupByData.csv");
+    handler->readData();
+    handler->process();
+    handler->writeData();
+
+    std::ifstream file("../data/GroupByData.csv.groups.csv");
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    file.close();
+
+    ASSERT_EQ(lines.size(), 4u);
+    EXPECT_EQ(lines[0], "id,count,mean,min,max");
+    EXPECT_EQ(lines[1], "7,2,20,10,30");
+    EXPECT_EQ(lines[2], "3,2,30,20,40");
+    EXPECT_EQ(lines[3], "5,1,5,5,5");
+
+    delete creator;
+    std::remove("../data/GroupByData.csv");
+    std::remove("../data/GroupByData.csv.state");
+    std::remove("../data/GroupByData.csv.groups.csv");
+}
+
+TEST_F(FileHandlerTest, JsonFileHandlerGroupBy) {
+    std::ofstream jsonFile("../data/GroupByData.json");
+    jsonFile << R"([{"id": 7, "value": 10}, {"id": "a", "value": 20}, {"id": 7, "value": 30}])";
+    jsonFile.close();
+
+    ProcessingOptions options;
+    options.groupBy = true;
+    FileHandlerCreator* creator = new JsonFileHandlerCreator(options);
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/GroupByData.json");
+    handler->readData();
+    handler->process();
+    handler->writeData();
+
+    std::ifstream file("../data/GroupByData.json.groups.json");
+    nlohmann::json groupsData;
+    file >> groupsData;
+    file.close();
+
+    ASSERT_EQ(groupsData.size(), 2u);
+    EXPECT_EQ(groupsData[0]["id"], 7);
+    EXPECT_EQ(groupsData[0]["count"], 2);
+    EXPECT_NEAR(groupsData[0]["mean"].get<double>(), 20.0, 1e-9);
+    EXPECT_EQ(groupsData[1]["id"], "a");
+    EXPECT_NEAR(groupsData[1]["max"].get<double>(), 20.0, 1e-9);
+
+    delete creator;
+    std::remove("../data/GroupByData.json");
+    std::remove("../data/GroupByData.json.groups.json");
+}
+
+TEST(GroupByTest, ParallelAggregationMatchesSerial) {
+    std::vector<std::string> idStrings;
+    std::vector<double> values;
+    for (size_t i = 0; i < 300000; ++i) {
+        idStrings.push_back(std::to_string((i * 7919) % 1013));
+        values.push_back(static_cast<double>(i % 97));
+    }
+    std::vector<std::string_view> ids(idStrings.begin(), idStrings.end());
+
+    GroupTable serial = aggregateGroups(ids, values, 1);
+    GroupTable parallel = aggregateGroups(ids, values, 4);
+
+    ASSERT_EQ(serial.size(), 1013u);
+    ASSERT_EQ(parallel.size(), serial.size());
+    serial.forEach([&parallel](const std::string& id, const GroupStatistics& group) {
+        const GroupStatistics* other = parallel.find(std::string_view(id));
+        ASSERT_NE(other, nullptr);
+        EXPECT_EQ(other->count, group.count);
+        EXPECT_EQ(other->sum, group.sum);
+        EXPECT_EQ(other->min, group.min);
+        EXPECT_EQ(other->max, group.max);
+        EXPECT_EQ(other->firstRow, group.firstRow);
+    });
+}
+
+TEST_F(FileHandlerTest, CsvFileHandlerAllColumns) {
+    std::ofstream csvFile("../data/MultiColumnData.csv");
+    csvFile << "id,value,label,value2\n1,10,a,100\n2,20,b,200\n3,30,c,600\n";
+    csvFile.close();
+
+    ProcessingOptions options;
+    options.allColumns = true;
+    options.threads = 2;
+    FileHandlerCreator* creator = new CsvFileHandlerCreator(options);
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/MultiColumnData.csv");
+    handler->readData();
+    handler->process();
+    handler->writeData();
+
+    std::ifstream file("../data/MultiColumnData.csv");
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    file.close();
+
+    // Statistics sit under their column; the text column is left blank
+    ASSERT_EQ(lines.size(), 7u);
+    EXPECT_EQ(lines[4], "mean,20,,300");
+    EXPECT_EQ(lines[5], "median,20,,200");
+    EXPECT_EQ(lines[6].rfind("std_dev,8.164965809277", 0), 0u);
+
+    delete creator;
+    std::remove("../data/MultiColumnData.csv");
+    std::remove("../data/MultiColumnData.csv.state");
+}
+
+TEST_F(FileHandlerTest, JsonFileHandlerAllColumns) {
+    std::ofstream jsonFile("../data/MultiColumnData.json");
+    jsonFile << R"([{"id": 1, "value": 10, "value2": 5, "name": "x"}, {"id": 2, "value": 30, "value2": 7, "name": "y"}])";
+    jsonFile.close();
+
+    ProcessingOptions options;
+    options.allColumns = true;
+    FileHandlerCreator* creator = new JsonFileHandlerCreator(options);
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/MultiColumnData.json");
+    handler->readData();
+    handler->process();
+    handler->writeData();
+
+    std::ifstream file("../data/MultiColumnData.json");
+    nlohmann::json jsonData;
+    file >> jsonData;
+    file.close();
+
+    const auto& statsEntry = jsonData.back();
+    EXPECT_EQ(statsEntry.size(), 2u);
+    EXPECT_NEAR(statsEntry["value"]["mean"].get<double>(), 20.0, 1e-9);
+    EXPECT_NEAR(statsEntry["value2"]["median"].get<double>(), 6.0, 1e-9);
+    EXPECT_FALSE(statsEntry.contains("id"));
+
+    delete creator;
+    std::remove("../data/MultiColumnData.json");
+}
+
+TEST_F(FileHandlerTest, CsvFileHandlerRollingWindow) {
+    ProcessingOptions options;
+    options.rollingWindow = 2;
+    FileHandlerCreator* creator = new CsvFileHandlerCreator(options);
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/GoogleTestData.csv");
+    handler->readData();
+    handler->process();
+    handler->writeData();
+
+    std::ifstream file("../data/GoogleTestData.csv");
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    file.close();
+
+    EXPECT_EQ(lines[0], "id,value,rolling_mean,rolling_std_dev,rolling_min,rolling_max");
+    EXPECT_EQ(lines[1], "12335,10,10,0,10,10");
+    EXPECT_EQ(lines[2], "43452,20,15,5,10,20");
+    EXPECT_EQ(lines[4], "67890,40,35,5,30,40");
+    EXPECT_EQ(lines.back(), "std_dev,11.180339887498949");
+
+    delete creator;
+}
+
+TEST(RollingStatisticsTest, MatchesBruteForce) {
+    std::mt19937 gen(7);
+    std::normal_distribution<> valueDist(50.0, 20.0);
+    std::vector<double> values(2000);
+    for (double& value : values) {
+        value = valueDist(gen);
+    }
+
+    const size_t windowSize = 37;
+    std::vector<RollingValues> rolling = calculateRollingStatistics(values, windowSize);
+    ASSERT_EQ(rolling.size(), values.size());
+
+    for (size_t i = 0; i < values.size(); ++i) {
+        size_t first = i + 1 >= windowSize ? i + 1 - windowSize : 0;
+        std::vector<double> window(values.begin() + first, values.begin() + i + 1);
+        double mean = 0;
+        for (double value : window) mean += value;
+        mean /= window.size();
+        double variance = 0;
+        for (double value : window) variance += (value - mean) * (value - mean);
+        variance /= window.size();
+
+        EXPECT_NEAR(rolling[i].mean, mean, 1e-9);
+        EXPECT_NEAR(rolling[i].std_dev, std::sqrt(variance), 1e-9);
+        EXPECT_EQ(rolling[i].min, *std::min_element(window.begin(), window.end()));
+        EXPECT_EQ(rolling[i].max, *std::max_element(window.begin(), window.end()));
+    }
+}
+
+TEST(RollingStatisticsTest, WindowLongerThanInput) {
+    std::vector<double> values = {3, 1, 4, 1, 5};
+    std::vector<RollingValues> huge = calculateRollingStatistics(values, 4000000000);
+    std::vector<RollingValues> whole = calculateRollingStatistics(values, values.size());
+    ASSERT_EQ(huge.size(), values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        EXPECT_EQ(huge[i].mean, whole[i].mean);
+        EXPECT_EQ(huge[i].std_dev, whole[i].std_dev);
+        EXPECT_EQ(huge[i].min, whole[i].min);
+        EXPECT_EQ(huge[i].max, whole[i].max);
+    }
+}
+
+TEST_F(FileHandlerTest, CsvFileHandlerDistinctIds) {
+    std::ofstream csvFile("../data/DistinctIdsData.csv");
+    csvFile << "id,value\n1,10\n2,20\n1,30\n3,40\n2,50\n";
+    csvFile.close();
+
+    ProcessingOptions options;
+    options.distinctIds = true;
+    FileHandlerCreator* creator = new CsvFileHandlerCreator(options);
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/DistinctIdsData.csv");
+    handler->readData();
+    handler->process();
+    handler->writeData();
+
+    std::ifstream file("../data/DistinctIdsData.csv");
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    file.close();
+
+    EXPECT_EQ(lines.back(), "distinct_ids,3");
+    EXPECT_EQ(lines[lines.size() - 2], "std_dev,14.142135623730951");
+
+    delete creator;
+    std::remove("../data/DistinctIdsData.csv");
+    std::remove("../data/DistinctIdsData.csv.state");
+}
+
+TEST(HashTest, MatchesXxh64ReferenceValues) {
+    EXPECT_EQ(hash64(""), 0xEF46DB3751D8E999ULL);
+    EXPECT_EQ(hash64("abc"), 0x44BC2CF5AD770999ULL);
+    EXPECT_NE(hash64("abc", 1), hash64("abc"));
+}
+
+TEST(HyperLogLogTest, EstimateAndMerge) {
+    HyperLogLog first;
+    HyperLogLog second;
+    for (int i = 0; i < 60000; ++i) {
+        first.add(std::to_string(i));
+        second.add(std::to_string(i + 40000)); // 20000 ids overlap
+    }
+
+    EXPECT_NEAR(static_cast<double>(first.estimate()), 60000.0, 60000.0 * 0.05);
+    ASSERT_TRUE(first.merge(second));
+    EXPECT_NEAR(static_cast<double>(first.estimate()), 100000.0, 100000.0 * 0.05);
+    EXPECT_FALSE(first.merge(HyperLogLog(10)));
+
+    HyperLogLog small;
+    for (int i = 0; i < 100; ++i) {
+        small.add(std::to_string(i % 37));
+    }
+    EXPECT_EQ(small.estimate(), 37u);
+}
+
+TEST_F(FileHandlerTest, JsonFileHandlerTopIds) {
+    std::ofstream jsonFile("../data/TopIdsData.json");
+    jsonFile << R"([{"id": 7, "value": 1}, {"id": "b", "value": 2}, {"id": 7, "value": 3}, {"id": 9, "value": 4}, {"id": 7, "value": 5}, {"id": "b", "value": 6}])";
+    jsonFile.close();
+
+    ProcessingOptions options;
+    options.topK = 2;
+    FileHandlerCreator* creator = new JsonFileHandlerCreator(options);
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/TopIdsData.json");
+    handler->readData();
+    handler->process();
+    handler->writeData();
+
+    std::ifstream file("../data/TopIdsData.json");
+    nlohmann::json jsonData;
+    file >> jsonData;
+    file.close();
+
+    const auto& top = jsonData.back()["top_ids"];
+    ASSERT_EQ(top.size(), 2u);
+    EXPECT_EQ(top[0]["id"], 7);
+    EXPECT_EQ(top[0]["count"], 3);
+    EXPECT_EQ(top[1]["id"], "b");
+    EXPECT_EQ(top[1]["count"], 2);
+
+    delete creator;
+    std::remove("../data/TopIdsData.json");
+}
+
+TEST(SpaceSavingTest, FindsHeavyHittersAndMerges) {
+    // Zipf-like stream: id i occurs about 20000 / i times, plus a long tail
+    SpaceSaving first(50);
+    SpaceSaving second(50);
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<> tailDist(1000, 100000);
+    for (int round = 0; round < 2; ++round) {
+        SpaceSaving& sketch = round == 0 ? first : second;
+        for (int id = 1; id <= 10; ++id) {
+            for (int n = 0; n < 10000 / id; ++n) {
+                sketch.add(std::to_string(id));
+                sketch.add(std::to_string(tailDist(gen)));
+            }
+        }
+    }
+
+    first.merge(second);
+    std::vector<SpaceSaving::Counter> top = first.top(5);
+    ASSERT_EQ(top.size(), 5u);
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(top[i].key, std::to_string(i + 1));
+        uint64_t trueCount = 2 * (10000 / (i + 1));
+        EXPECT_GE(top[i].count, trueCount);
+        EXPECT_LE(top[i].count - top[i].error, trueCount);
+    }
+}
+
+TEST(FlatHashMapTest, EraseKeepsProbeChainsIntact) {
+    FlatHashMap<std::string, int, std::hash<std::string_view>> map;
+    for (int i = 0; i < 5000; ++i) {
+        map[std::to_string(i)] = i;
+    }
+    for (int i = 0; i < 5000; i += 3) {
+        EXPECT_TRUE(map.erase(std::string_view(std::to_string(i))));
+    }
+    EXPECT_FALSE(map.erase(std::string_view("missing")));
+
+    for (int i = 0; i < 5000; ++i) {
+        const int* value = map.find(std::string_view(std::to_string(i)));
+        if (i % 3 == 0) {
+            EXPECT_EQ(value, nullptr);
+        }
+        else {
+            ASSERT_NE(value, nullptr);
+            EXPECT_EQ(*value, i);
+        }
+    }
+    EXPECT_EQ(map.size(), 5000u - 1667u);
+}
+
+TEST_F(FileHandlerTest, CsvFileHandlerSelectedStatistics) {
+    ProcessingOptions options;
+    options.statistics = StatMean | StatStdDev;
+    FileHandlerCreator* creator = new CsvFileHandlerCreator(options);
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/GoogleTestData.csv");
+    handler->readData();
+    handler->process();
+    handler->writeData();
+
+    std::ifstream file("../data/GoogleTestData.csv");
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    file.close();
+
+    ASSERT_EQ(lines.size(), 7u);
+    EXPECT_EQ(lines[5], "mean,25");
+    EXPECT_EQ(lines[6], "std_dev,11.180339887498949");
+
+    delete creator;
+}
+
+TEST(StatisticSetTest, CompileTimeSetsMatchRuntimeSelection) {
+    std::vector<double> values = {4, 8, 15, 16, 23, 42};
+
+    static_assert(Stats<Mean, StdDev>::has<Mean>);
+    static_assert(!Stats<Mean, StdDev>::has<Median>);
+    static_assert(Stats<Mean, StdDev>::mask == (StatMean | StatStdDev));
+
+    Statistics meanOnly = Stats<Mean>::compute(values);
+    EXPECT_NEAR(meanOnly.mean, 18.0, 1e-12);
+    EXPECT_EQ(meanOnly.median, 0.0); // Not computed
+
+    ProcessingOptions options;
+    options.percentiles = {90};
+    Statistics full = Stats<Mean, Median, StdDev, Percentiles>::compute(values, options);
+    Statistics runtime = calculateStatistics(values, options);
+    EXPECT_EQ(full.mean, runtime.mean);
+    EXPECT_EQ(full.median, runtime.median);
+    EXPECT_EQ(full.std_dev, runtime.std_dev);
+    EXPECT_EQ(full.percentileValues, runtime.percentileValues);
+    EXPECT_NEAR(full.median, 15.5, 1e-12);
+    EXPECT_NEAR(full.percentileValues[0], 32.5, 1e-12);
+}
+
+TEST_F(FileHandlerTest, CsvFileHandlerCorrelation) {
+    std::ofstream csvFile("../data/CorrelationData.csv");
+    csvFile << "id,a,b,c\n1,1,2,5\n2,2,4,3\n3,3,6,4\n4,4,8,1\n";
+    csvFile.close();
+
+    ProcessingOptions options;
+    options.correlation = true;
+    FileHandlerCreator* creator = new CsvFileHandlerCreator(options);
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/CorrelationData.csv");
+    handler->readData();
+    handler->process();
+    handler->writeData();
+
+    std::ifstream file("../data/CorrelationData.csv.correlation.csv");
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    file.close();
+
+    ASSERT_EQ(lines.size(), 4u);
+    EXPECT_EQ(lines[0], "correlation,a,b,c");
+    EXPECT_EQ(lines[1], "a,1,1,-0.8315218406202999");
+    EXPECT_EQ(lines[2], "b,1,1,-0.8315218406202999");
+
+    std::ifstream covarianceFile("../data/CorrelationData.csv.covariance.csv");
+    std::getline(covarianceFile, line);
+    std::getline(covarianceFile, line);
+    EXPECT_EQ(line, "a,1.25,2.5,-1.375");
+    covarianceFile.close();
+
+    delete creator;
+    std::remove("../data/CorrelationData.csv");
+    std::remove("../data/CorrelationData.csv.state");
+    std::remove("../data/CorrelationData.csv.correlation.csv");
+    std::remove("../data/CorrelationData.csv.covariance.csv");
+}
+
+TEST(CovarianceMatrixTest, ParallelBlockedMatchesTwoPass) {
+    std::mt19937 gen(11);
+    std::normal_distribution<> noise(0.0, 1.0);
+    const size_t rows = 200003;
+    std::vector<std::vector<double>> columns(3, std::vector<double>(rows));
+    for (size_t r = 0; r < rows; ++r) {
+        columns[0][r] = 1000.0 + noise(gen);
+        columns[1][r] = 0.5 * columns[0][r] + noise(gen);
+        columns[2][r] = -2.0 * columns[0][r] + 0.1 * noise(gen);
+    }
+
+    CovarianceMatrix matrix = calculateCovariance(columns, 4);
+    ASSERT_EQ(matrix.rowCount(), rows);
+
+    for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            double meanI = 0, meanJ = 0;
+            for (size_t r = 0; r < rows; ++r) {
+                meanI += columns[i][r];
+                meanJ += columns[j][r];
+            }
+            meanI /= rows;
+            meanJ /= rows;
+            double comoment = 0;
+            for (size_t r = 0; r < rows; ++r) {
+                comoment += (columns[i][r] - meanI) * (columns[j][r] - meanJ);
+            }
+            EXPECT_NEAR(matrix.covariance(i, j), comoment / rows, 1e-9);
+        }
+    }
+    EXPECT_NEAR(matrix.correlation(0, 0), 1.0, 1e-12);
+    EXPECT_LT(matrix.correlation(0, 2), -0.99);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
 }
+
+TEST(StatisticsTest, MadAndOutliers) {
+    // The single large value inflates std_dev enough to mask itself from the
+    // z-score test, while the MAD based test still flags it
+    std::vector<double> values = {1, 2, 3, 4, 5, 6, 7, 8, 9, 100};
+    ProcessingOptions options;
+    options.writeOutliers = true;
+    Statistics stats = calculateStatistics(values, options);
+
+    EXPECT_NEAR(stats.median, 5.5, 1e-12);
+    EXPECT_NEAR(stats.mad, 2.5, 1e-12);
+    EXPECT_EQ(stats.zScoreOutliers, 0u);
+    EXPECT_EQ(stats.madOutliers, 1u);
+    ASSERT_EQ(stats.outliers.size(), 1u);
+    EXPECT_EQ(stats.outliers[0].row, 9u);
+    EXPECT_EQ(stats.outliers[0].value, 100.0);
+
+    options.zScoreThreshold = 2.5;
+    EXPECT_EQ(calculateStatistics(values, options).zScoreOutliers, 1u);
+}
+
+TEST_F(FileHandlerTest, CsvFileHandlerOutliers) {
+    std::ofstream csvFile("../data/OutlierData.csv");
+    csvFile << "id,value\na,1\nb,2\nc,3\nd,4\ne,5\nf,6\ng,7\nh,8\ni,9\nj,100\n";
+    csvFile.close();
+
+    ProcessingOptions options;
+    options.writeOutliers = true;
+    FileHandlerCreator* creator = new CsvFileHandlerCreator(options);
+    std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/OutlierData.csv");
+    handler->readData();
+    handler->process();
+    handler->writeData();
+
+    std::ifstream file("../data/OutlierData.csv");
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    file.close();
+
+    ASSERT_EQ(lines.size(), 17u);
+    EXPECT_EQ(lines[14], "mad,2.5");
+    EXPECT_EQ(lines[15], "z_outliers,0");
+    EXPECT_EQ(lines[16], "mad_outliers,1");
+
+    std::ifstream outliersFile("../data/OutlierData.csv.outliers.csv");
+    std::getline(outliersFile, line);
+    EXPECT_EQ(line, "row,id,value");
+    std::getline(outliersFile, line);
+    EXPECT_EQ(line, "9,j,100");
+    outliersFile.close();
+
+    delete creator;
+    std::remove("../data/OutlierData.csv");
+    std::remove("../data/OutlierData.csv.state");
+    std::remove("../data/OutlierData.csv.outliers.csv");
+}
+
+TEST_F(FileHandlerTest, CsvFileHandlerIncrementalAppend) {
+    ProcessingOptions options;
+    options.incremental = true;
+    options.statistics = StatMean | StatStdDev;
+    options.distinctIds = true;
+    options.histogramDigits = 2;
+    auto run = [&options]() {
+        FileHandlerCreator* creator = new CsvFileHandlerCreator(options);
+        std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/GoogleTestData.csv");
+        handler->readData();
+        handler->process();
+        handler->writeData();
+        delete creator;
+    };
+    auto readLines = []() {
+        std::ifstream file("../data/GoogleTestData.csv");
+        std::string line;
+        std::vector<std::string> lines;
+        while (std::getline(file, line)) {
+            lines.push_back(line);
+        }
+        return lines;
+    };
+
+    run();
+    std::ofstream appended("../data/GoogleTestData.csv", std::ios::app);
+    appended << "5,50\n6,60\n";
+    appended.close();
+    run();
+    std::vector<std::string> incremental = readLines();
+
+    // The footer must match processing the whole file from scratch
+    std::ofstream csvFile("../data/GoogleTestData.csv");
+    csvFile << "id,value\n12335,10\n43452,20\n56789,30\n67890,40\n5,50\n6,60\n";
+    csvFile.close();
+    options.incremental = false;
+    run();
+    std::vector<std::string> full = readLines();
+
+    EXPECT_EQ(incremental, full);
+    ASSERT_EQ(incremental.size(), 11u);
+    EXPECT_EQ(incremental[6], "6,60");
+    EXPECT_EQ(incremental[7], "mean,35");
+    EXPECT_EQ(incremental[10], "distinct_ids,6");
+
+    std::remove("../data/GoogleTestData.csv.state");
+}
+
+TEST_F(FileHandlerTest, CsvIncrementalFinishesInterruptedAppend) {
+    ProcessingOptions options;
+    options.incremental = true;
+    options.statistics = StatMean;
+    auto run = [&options](bool write) {
+        CsvFileHandler handler("../data/GoogleTestData.csv", options);
+        handler.readData();
+        if (!write) return;
+        handler.process();
+        handler.writeData();
+    };
+    auto read = [](const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    };
+    auto write = [](const std::string& path, const std::string& text) {
+        std::ofstream file(path, std::ios::binary);
+        file << text;
+    };
+
+    run(true);
+    std::ofstream appended("../data/GoogleTestData.csv", std::ios::app);
+    appended << "5,50\n";
+    appended.close();
+    std::string before = read("../data/GoogleTestData.csv");
+    std::string stateBefore = read("../data/GoogleTestData.csv.state");
+    run(true);
+    std::string after = read("../data/GoogleTestData.csv");
+    std::string stateAfter = read("../data/GoogleTestData.csv.state");
+    ASSERT_NE(after, before);
+
+    // Crash while the appended row was moved up over the old footer: the
+    // journal is complete, the data file half patched, the state still old
+    size_t offset = before.find("mean,");
+    ASSERT_NE(offset, std::string::npos);
+    std::string tail = after.substr(offset);
+    std::ostringstream journal;
+    journal << offset << ' ' << tail.size() << '\n' << tail << stateAfter;
+    write("../data/GoogleTestData.csv.state.tail", journal.str());
+    write("../data/GoogleTestData.csv", before.substr(0, offset) + tail.substr(0, 3) + before.substr(offset + 3));
+    write("../data/GoogleTestData.csv.state", stateBefore);
+
+    run(false);
+    EXPECT_EQ(read("../data/GoogleTestData.csv"), after);
+    EXPECT_EQ(read("../data/GoogleTestData.csv.state"), stateAfter);
+    EXPECT_FALSE(std::filesystem::exists("../data/GoogleTestData.csv.state.tail"));
+
+    std::remove("../data/GoogleTestData.csv.state");
+}
+
+TEST_F(FileHandlerTest, SidecarOutputLeavesDataUntouched) {
+    ProcessingOptions options;
+    options.output = OutputMode::Sidecar;
+    for (const std::string path : {"../data/GoogleTestData.csv", "../data/GoogleTestData.json"}) {
+        std::ifstream before(path);
+        std::string original((std::istreambuf_iterator<char>(before)), std::istreambuf_iterator<char>());
+        before.close();
+
+        FileHandlerCreator* creator = nullptr;
+        if (path.substr(path.size() - 4) == ".csv") creator = new CsvFileHandlerCreator(options);
+        else creator = new JsonFileHandlerCreator(options);
+        std::unique_ptr<FileHandler> handler = creator->createFileHandler(path);
+        handler->readData();
+        handler->process();
+        handler->writeData();
+        delete creator;
+
+        std::ifstream after(path);
+        std::string written((std::istreambuf_iterator<char>(after)), std::istreambuf_iterator<char>());
+        after.close();
+        EXPECT_EQ(written, original);
+
+        std::ifstream sidecar(path + ".stats.json");
+        nlohmann::json statsEntry;
+        sidecar >> statsEntry;
+        sidecar.close();
+        EXPECT_EQ(statsEntry["mean"], 25);
+        EXPECT_EQ(statsEntry["median"], 25);
+        EXPECT_NEAR(statsEntry["std_dev"].get<double>(), 11.1803, 1e-4);
+        std::remove((path + ".stats.json").c_str());
+    }
+}
+
+TEST_F(FileHandlerTest, CsvFileHandlerAppendFooter) {
+    // No trailing newline, so one has to be added before the footer
+    std::ofstream csvFile("../data/GoogleTestData.csv");
+    csvFile << "id,value\n12335,10\n43452,20\n56789,30\n67890,40";
+    csvFile.close();
+
+    ProcessingOptions options;
+    options.output = OutputMode::Append;
+    for (int run = 0; run < 2; ++run) {
+        FileHandlerCreator* creator = new CsvFileHandlerCreator(options);
+        std::unique_ptr<FileHandler> handler = creator->createFileHandler("../data/GoogleTestData.csv");
+        handler->readData();
+        handler->process();
+        handler->writeData();
+        delete creator;
+    }
+
+    // The second run replaces the first footer instead of reading it as data
+    std::ifstream file("../data/GoogleTestData.csv");
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    EXPECT_EQ(content, "id,value\n12335,10\n43452,20\n56789,30\n67890,40\nmean,25\nmedian,25\nstd_dev,11.180339887498949\n");
+
+    // Invalid rows leave the footer of the earlier run in place
+    std::ofstream("../data/GoogleTestData.csv", std::ios::app) << "11111,abc\n";
+    CsvFileHandler invalid("../data/GoogleTestData.csv", options);
+    invalid.readData();
+    invalid.process();
+    invalid.writeData();
+    file.open("../data/GoogleTestData.csv");
+    std::string kept((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    EXPECT_EQ(kept, content + "11111,abc\n");
+    EXPECT_FALSE(std::filesystem::exists("../data/GoogleTestData.csv.state.tail"));
+    std::remove("../data/GoogleTestData.csv.state");
+
+    // A missing file gets no journal that later runs would retry
+    CsvFileHandler missing("../data/MissingAppendData.csv", options);
+    missing.readData();
+    missing.process();
+    missing.writeData();
+    EXPECT_FALSE(missing.errorMessage().empty());
+    EXPECT_FALSE(std::filesystem::exists("../data/MissingAppendData.csv"));
+    EXPECT_FALSE(std::filesystem::exists("../data/MissingAppendData.csv.state.tail"));
+}
+
+TEST_F(FileHandlerTest, CsvRowsLikeFooterLabelsAreData) {
+    // Rows labelled like statistics, but not written by an earlier run
+    std::ofstream("../data/GoogleTestData.csv") << "id,value\na,1\nb,2\np1,10\np2,20";
+    CsvFileHandler handler("../data/GoogleTestData.csv");
+    handler.readData();
+    handler.process();
+    ASSERT_NE(handler.valueStatistics(), nullptr);
+    EXPECT_DOUBLE_EQ(handler.valueStatistics()->mean, 8.25);
+    handler.writeData();
+
+    std::ifstream file("../data/GoogleTestData.csv");
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    EXPECT_EQ(content.substr(0, 34), "id,value\na,1\nb,2\np1,10\np2,20\nmean,");
+
+    // Once rows follow it, the footer is no longer recognised and is kept as data
+    std::ofstream("../data/GoogleTestData.csv", std::ios::app) << "c,3\n";
+    CsvFileHandler edited("../data/GoogleTestData.csv");
+    edited.readData();
+    edited.process();
+    edited.writeData();
+    file.open("../data/GoogleTestData.csv");
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    EXPECT_NE(content.find("p2,20\nmean,8.25\nmedian,6\n"), std::string::npos);
+    EXPECT_NE(content.find("c,3\nmean,"), std::string::npos);
+}
+
+TEST_F(FileHandlerTest, CsvRewriteFindsFooterWithoutStateFile) {
+    std::string rows = "id\tvalue\n1\t10\n2\t20\n3\t30\n";
+    std::ofstream("../data/GoogleTestData.csv") << rows;
+    ProcessingOptions options;
+    options.delimiter = '\t';
+    options.percentiles = {90};
+    options.distinctIds = true;
+    auto run = [&options]() {
+        CsvFileHandler handler("../data/GoogleTestData.csv", options);
+        handler.readData();
+        handler.process();
+        handler.writeData();
+        std::ifstream file("../data/GoogleTestData.csv");
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    };
+
+    std::string first = run();
+    EXPECT_EQ(first.substr(0, rows.size() + 8), rows + "mean\t20\n");
+    EXPECT_FALSE(std::filesystem::exists("../data/GoogleTestData.csv.state"));
+    EXPECT_EQ(run(), first);
+
+    // A footer written with other options no longer matches its labels
+    options.percentiles.clear();
+    EXPECT_NE(run().find("p90\t"), std::string::npos);
+}
+
+TEST(AtomicFileWriterTest, ReplacesOnlyOnCommit) {
+    const std::string path = "../data/AtomicData.csv";
+    std::ofstream original(path);
+    original << "id,value\n1,10\n2,20\nmean,15\n";
+    original.close();
+    auto readAll = [&path]() {
+        std::ifstream file(path);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    };
+
+    {
+        AtomicFileWriter writer(path);
+        ASSERT_TRUE(writer.isOpen());
+        writer << "partial";
+        // Destroyed without commit: the original stays in place
+    }
+    EXPECT_EQ(readAll(), "id,value\n1,10\n2,20\nmean,15\n");
+
+    {
+        // Small buffer, so the prefix copy and the stream output interleave
+        AtomicFileWriter writer(path, 16);
+        ASSERT_TRUE(writer.copyFrom(path, 19));
+        writer << "3,30\n";
+        EXPECT_EQ(static_cast<uint64_t>(writer.tellp()), 24u);
+        EXPECT_TRUE(writer.commit());
+    }
+    EXPECT_EQ(readAll(), "id,value\n1,10\n2,20\n3,30\n");
+    std::remove(path.c_str());
+}
+
+TEST(OutputBufferTest, FormatsShortestRoundTrip) {
+    OutputBuffer text;
+    text << "x," << 0.1 << ',' << 25.0 << ',' << -3 << ',' << size_t(18446744073709551615u) << ',' << std::nan("") << '\n';
+    EXPECT_EQ(text.view(), "x,0.1,25,-3,18446744073709551615,nan\n");
+
+    // Every double reads back to exactly the same value
+    std::mt19937_64 gen(5);
+    std::uniform_real_distribution<> valueDist(-1e6, 1e6);
+    for (int i = 0; i < 1000; ++i) {
+        double value = valueDist(gen);
+        OutputBuffer cell;
+        cell << value;
+        EXPECT_EQ(std::stod(std::string(cell.view())), value);
+    }
+
+    // A small capacity hands the text to the sink in blocks
+    std::ostringstream sink;
+    {
+        OutputBuffer out(sink, 8);
+        for (int i = 0; i < 100; ++i) out << i << '\n';
+    }
+    std::string expected;
+    for (int i = 0; i < 100; ++i) expected += std::to_string(i) + "\n";
+    EXPECT_EQ(sink.str(), expected);
+}
+
+TEST_F(FileHandlerTest, BatchProcessesDirectory) {
+    std::filesystem::create_directories("../data/batch/nested");
+    std::ofstream("../data/batch/a.csv") << "id,value\n1,10\n2,20\n";
+    std::ofstream("../data/batch/nested/b.json") << R"([{"id": 1, "value": 4}])";
+    std::ofstream("../data/batch/bad.csv") << "id,value\n1,abc\n";
+    std::ofstream("../data/batch/a.csv.groups.csv") << "id,count,mean,min,max\n";
+    std::ofstream("../data/batch/a.csv.tmpAb12Cd") << "id,value\n1,";
+    std::ofstream("../data/batch/export.csv.2024.csv") << "id,value\n1,3\n";
+    std::ofstream("../data/batch/notes.txt") << "not data\n";
+
+    // Only names this tool writes next to a data file are skipped
+    std::vector<std::string> files = expandInputs({"../data/batch", "../data/batch/*.txt", "../data/batch/*.tmp*"});
+    ASSERT_EQ(files.size(), 5u);
+    EXPECT_EQ(files[0], "../data/batch/a.csv");
+    EXPECT_EQ(files[1], "../data/batch/bad.csv");
+    EXPECT_EQ(files[2], "../data/batch/export.csv.2024.csv");
+    EXPECT_EQ(files[3], "../data/batch/nested/b.json");
+    EXPECT_EQ(files[4], "../data/batch/notes.txt");
+
+    ProcessingOptions options;
+    options.threads = 3;
+    std::vector<FileResult> results = processBatch(files, options);
+    ASSERT_EQ(results.size(), 5u);
+    EXPECT_EQ(results[0].status, FileResult::Processed);
+    EXPECT_EQ(results[1].status, FileResult::Failed);
+    EXPECT_EQ(results[2].status, FileResult::Processed);
+    EXPECT_EQ(results[3].status, FileResult::Processed);
+    EXPECT_EQ(results[4].status, FileResult::Unsupported);
+
+    std::ifstream file("../data/batch/a.csv");
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    EXPECT_EQ(content, "id,value\n1,10\n2,20\nmean,15\nmedian,15\nstd_dev,5\n");
+
+    // Each written file's version is sampled by its own task; failed files have none
+    FileVersion version;
+    ASSERT_TRUE(results[0].written.has_value());
+    ASSERT_TRUE(currentVersion("../data/batch/a.csv", version));
+    EXPECT_EQ(*results[0].written, version);
+    EXPECT_EQ(version.size, content.size());
+    EXPECT_FALSE(results[1].written.has_value());
+
+    std::ostringstream report;
+    printBatchReport(report, results, 0.5, 3);
+    EXPECT_NE(report.str().find("5 files in 0.500s on 3 workers: 3 processed, 1 failed, 1 skipped"), std::string::npos);
+
+    std::filesystem::remove_all("../data/batch");
+}
+
+TEST(TaskSchedulerTest, RunsNestedTasks) {
+    std::atomic<int> sum(0);
+    {
+        TaskScheduler scheduler(3);
+        for (int i = 0; i < 10; ++i) {
+            scheduler.submit([&scheduler, &sum, i]() {
+                for (int j = 0; j < 10; ++j) {
+                    scheduler.submit([&sum, i, j]() { sum += i * 10 + j; });
+                }
+            });
+        }
+        scheduler.wait();
+        EXPECT_EQ(sum.load(), 4950);
+        EXPECT_TRUE(scheduler.takeErrors().empty());
+
+        // A throwing task is reported to the caller, not printed
+        scheduler.submit([]() { throw std::runtime_error("broken"); });
+        scheduler.wait();
+        EXPECT_EQ(scheduler.takeErrors(), std::vector<std::string>{"Task failed: broken"});
+        EXPECT_TRUE(scheduler.takeErrors().empty());
+    }
+}
+
+TEST_F(FileHandlerTest, BatchChunkedMatchesWholeFile) {
+    std::filesystem::create_directories("../data/chunked");
+    std::string rows = "id,value\n";
+    for (int i = 0; i < 200; ++i) {
+        rows += std::to_string(i % 17) + "," + std::to_string((i * 37) % 101) + ".5\n";
+    }
+    std::ofstream("../data/chunked/whole.csv") << rows;
+    std::ofstream("../data/chunked/split.csv") << rows;
+
+    ProcessingOptions options;
+    options.threads = 4;
+    options.percentiles = {90};
+    options.distinctIds = true;
+    options.chunkSize = 0;
+    // The second run recognises the footer of the first and replaces it rather than parsing it
+    ASSERT_EQ(processBatch({"../data/chunked/whole.csv", "../data/chunked/split.csv"}, options)[1].status, FileResult::Processed);
+    ASSERT_EQ(processBatch({"../data/chunked/whole.csv"}, options)[0].status, FileResult::Processed);
+    options.chunkSize = 100;
+    EXPECT_GT(CsvFileHandler("../data/chunked/split.csv", options).prepareChunks(options.chunkSize), 10u);
+    ASSERT_EQ(processBatch({"../data/chunked/split.csv"}, options)[0].status, FileResult::Processed);
+
+    auto read = [](const std::string& path) {
+        std::ifstream file(path);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    };
+    std::string whole = read("../data/chunked/whole.csv");
+    EXPECT_NE(whole.find("distinct_ids,17"), std::string::npos);
+    EXPECT_EQ(read("../data/chunked/split.csv"), whole);
+
+    std::filesystem::remove_all("../data/chunked");
+}
+
+TEST_F(FileHandlerTest, CsvFileHandlerPipelineMatchesSequentialRead) {
+    // Larger than one read block, so rows are carried across blocks
+    std::string rows = "id,value\n";
+    for (int i = 0; i < 150000; ++i) {
+        rows += std::to_string(i % 1000) + "," + std::to_string((i * 7919) % 10007) + "\n";
+        // A row longer than several read blocks
+        if (i == 70000) rows += std::string(size_t(3) << 20, 'x') + ",5\n";
+    }
+    std::ofstream("../data/pipeline_a.csv") << rows;
+    std::ofstream("../data/pipeline_b.csv") << rows;
+
+    ProcessingOptions options;
+    options.percentiles = {99};
+    options.distinctIds = true;
+    CsvFileHandler sequential("../data/pipeline_a.csv", options);
+    sequential.readData();
+    sequential.process();
+    sequential.writeData();
+
+    options.pipeline = true;
+    CsvFileHandler pipelined("../data/pipeline_b.csv", options);
+    pipelined.readData();
+    pipelined.process();
+    pipelined.writeData();
+    EXPECT_TRUE(pipelined.succeeded());
+
+    auto read = [](const std::string& path) {
+        std::ifstream file(path);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    };
+    EXPECT_EQ(read("../data/pipeline_b.csv"), read("../data/pipeline_a.csv"));
+
+    std::remove("../data/pipeline_a.csv");
+    std::remove("../data/pipeline_a.csv.state");
+    std::remove("../data/pipeline_b.csv");
+    std::remove("../data/pipeline_b.csv.state");
+}
+
+TEST(BoundedQueueTest, PassesItemsInOrder) {
+    BoundedQueue<int> queue(2);
+    std::thread producer([&queue]() {
+        for (int i = 0; i < 1000; ++i) queue.push(i);
+        queue.close();
+    });
+    int expected = 0;
+    int value = 0;
+    while (queue.pop(value)) {
+        EXPECT_EQ(value, expected++);
+    }
+    producer.join();
+    EXPECT_EQ(expected, 1000);
+}
+
+TEST(FileBatchReaderTest, ReadsEveryFileWithEitherBackend) {
+    std::filesystem::create_directories("../data/reader");
+    std::vector<std::string> paths;
+    for (int i = 0; i < 20; ++i) {
+        paths.push_back("../data/reader/" + std::to_string(i) + ".csv");
+        // Some files span several read operations
+        std::ofstream(paths.back()) << std::string(static_cast<size_t>(i) * 10000, 'a' + static_cast<char>(i));
+    }
+    paths.push_back("../data/reader/missing.csv");
+
+    for (bool ioUring : {true, false}) {
+        FileBatchReader reader(4, ioUring);
+        std::vector<std::string> contents(paths.size());
+        std::vector<int> errors(paths.size(), -1);
+        reader.readAll(paths, [&](size_t index, std::string&& data, int error) {
+            contents[index] = std::move(data);
+            errors[index] = error;
+        });
+        for (int i = 0; i < 20; ++i) {
+            EXPECT_EQ(errors[i], 0);
+            EXPECT_EQ(contents[i], std::string(static_cast<size_t>(i) * 10000, 'a' + static_cast<char>(i)));
+        }
+        EXPECT_EQ(errors.back(), ENOENT);
+    }
+
+    std::filesystem::remove_all("../data/reader");
+}
+
+TEST(DirectoryWatcherTest, ReportsChangedInputFiles) {
+    std::filesystem::create_directories("../data/watched");
+    DirectoryWatcher watcher({"../data/watched"});
+    ASSERT_TRUE(watcher.isOpen());
+
+    std::ofstream("../data/watched/a.csv") << "id,value\n1,10\n";
+    std::ofstream("../data/watched/a.csv.stats.json") << "{}";
+    std::ofstream("../data/watched/notes.txt") << "not data\n";
+    std::ofstream("../data/watched/a.csv", std::ios::app) << "2,20\n";
+
+    std::atomic<bool> stop(false);
+    std::vector<std::string> changed = watcher.wait(std::chrono::milliseconds(20), stop);
+    ASSERT_EQ(changed.size(), 1u);
+    EXPECT_EQ(changed[0], "../data/watched/a.csv");
+
+    std::filesystem::remove_all("../data/watched");
+}
+
+TEST(HashTest, ContentHasherIsIndependentOfSplitting) {
+    std::string text;
+    for (int i = 0; i < 5000; ++i) text += static_cast<char>(i * 131 + 7);
+    ContentHasher whole;
+    whole.update(text.data(), text.size());
+    ContentHasher pieces;
+    for (size_t offset = 0; offset < text.size(); offset += 37) {
+        pieces.update(text.data() + offset, std::min<size_t>(37, text.size() - offset));
+    }
+    EXPECT_EQ(pieces.digest(), whole.digest());
+
+    ContentHasher changed;
+    text[4000] ^= 1;
+    changed.update(text.data(), text.size());
+    EXPECT_NE(changed.digest(), whole.digest());
+}
+
+TEST_F(FileHandlerTest, BatchCacheSkipsUnchangedFiles) {
+    std::filesystem::create_directories("../data/cached");
+    std::ofstream("../data/cached/a.csv") << "id,value\n1,10\n2,20\n";
+    std::ofstream("../data/cached/b.csv") << "id,value\n1,1\n";
+    std::vector<std::string> files = expandInputs({"../data/cached"});
+
+    ProcessingOptions options;
+    options.threads = 2;
+    auto run = [&]() {
+        BatchResources resources(2);
+        resources.cache = std::make_unique<ResultCache>("../data/cached.cache");
+        return processBatch(files, options, resources);
+    };
+    std::vector<FileResult> first = run();
+    EXPECT_EQ(first[0].message, "");
+    EXPECT_NE(first[0].statistics.find("\"mean\":15"), std::string::npos);
+
+    // Unchanged files are not rewritten; the stored statistics are reported
+    std::vector<FileResult> second = run();
+    ASSERT_EQ(second[0].status, FileResult::Processed);
+    EXPECT_EQ(second[0].message, "unchanged");
+    EXPECT_EQ(second[0].statistics, first[0].statistics);
+    EXPECT_EQ(second[1].message, "unchanged");
+
+    std::ofstream("../data/cached/b.csv", std::ios::app) << "2,3\n";
+    std::vector<FileResult> third = run();
+    EXPECT_EQ(third[0].message, "unchanged");
+    EXPECT_EQ(third[1].message, "");
+    EXPECT_EQ(third[1].status, FileResult::Processed);
+
+    // Different options do not use the results of the previous ones
+    options.statistics = StatMean;
+    EXPECT_EQ(run()[0].message, "");
+
+    // A file that changed after the handler wrote it is not recorded
+    ResultCache cache("../data/cached.cache");
+    std::ofstream("../data/cached/c.csv") << "id,value\n1,1\n2,2\n";
+    cache.store("../data/cached/c.csv", options, "{}", 14);
+    std::string statistics;
+    EXPECT_FALSE(cache.lookup("../data/cached/c.csv", options, statistics));
+    cache.store("../data/cached/c.csv", options, "{}", 17);
+    EXPECT_TRUE(cache.lookup("../data/cached/c.csv", options, statistics));
+
+    std::filesystem::remove_all("../data/cached");
+    std::remove("../data/cached.cache");
+}
+
+TEST(FileSnifferTest, DetectsFormatAndDelimiter) {
+    EXPECT_EQ(sniffContents("[{\"id\": 1, \"value\": 2}]").format, FileFormat::Json);
+    EXPECT_EQ(sniffContents("{\n    \"id\": 1\n}").format, FileFormat::Json);
+    EXPECT_EQ(sniffContents("{\"id\": 1}\n{\"id\": 2}\n").format, FileFormat::Ndjson);
+    EXPECT_EQ(sniffContents("\xef\xbb\xbfid,value\n1,2\n").format, FileFormat::Csv);
+
+    SniffResult tabs = sniffContents("id\tvalue\n1\t2.5\n2\t3,5\n");
+    EXPECT_EQ(tabs.format, FileFormat::Csv);
+    EXPECT_EQ(tabs.delimiter, '\t');
+    EXPECT_EQ(sniffContents("id;value\n1;\"a;b\"\n").delimiter, ';');
+
+    SniffResult gzip = sniffContents(std::string("\x1f\x8b\x08\x00", 4));
+    EXPECT_EQ(gzip.format, FileFormat::Compressed);
+    EXPECT_EQ(gzip.compression, "gzip");
+    EXPECT_EQ(sniffContents("not data\n").format, FileFormat::Unknown);
+    EXPECT_EQ(sniffContents(std::string("a,b\0c", 5)).format, FileFormat::Unknown);
+
+    // Text that only starts like a magic number or an array
+    EXPECT_EQ(sniffContents("BZh91AY&SY").format, FileFormat::Compressed);
+    EXPECT_EQ(sniffContents("BZh,value\nx,1\n").format, FileFormat::Csv);
+    EXPECT_EQ(sniffContents("[a],1\n[b],2\n").format, FileFormat::Csv);
+}
+
+TEST_F(FileHandlerTest, BatchLeavesUnparsableFilesUntouched) {
+    std::filesystem::create_directories("../data/unparsable");
+    const std::map<std::string, std::string> contents = {
+        {"../data/unparsable/array.csv", "[1],2\n[3],4\n"},
+        {"../data/unparsable/cut.ndjson", "{\"id\": 1, \"value\": 4}\n{\"id\": 2, \"val"},
+        {"../data/unparsable/cut.json", "[{\"id\": 1, \"value\": 4},"}
+    };
+    std::vector<std::string> files;
+    for (const auto& [path, text] : contents) {
+        std::ofstream(path) << text;
+        files.push_back(path);
+    }
+
+    std::vector<FileResult> results = processBatch(files, ProcessingOptions());
+    EXPECT_EQ(results[0].status, FileResult::Unsupported); // JSON contents in a .csv file
+    EXPECT_EQ(results[0].message, "contents do not match the .csv extension");
+    EXPECT_EQ(results[1].status, FileResult::Failed);
+    EXPECT_EQ(results[2].status, FileResult::Failed);
+    for (const auto& [path, text] : contents) {
+        std::ifstream file(path);
+        EXPECT_EQ(std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()), text) << path;
+    }
+    std::filesystem::remove_all("../data/unparsable");
+}
+
+TEST_F(FileHandlerTest, BatchRoutesFilesByContents) {
+    std::filesystem::create_directories("../data/sniffed");
+    std::ofstream("../data/sniffed/tabs.csv") << "id\tvalue\n1\t10\n2\t20\n";
+    std::ofstream("../data/sniffed/lines.json") << "{\"id\": 1, \"value\": 4}\n{\"id\": 2, \"value\": 8}\n";
+    std::ofstream("../data/sniffed/packed.csv") << std::string("\x1f\x8b\x08\x00", 4);
+    std::vector<std::string> files = expandInputs({"../data/sniffed"});
+    ASSERT_EQ(files.size(), 3u);
+
+    std::vector<FileResult> results = processBatch(files, ProcessingOptions());
+    EXPECT_EQ(results[0].status, FileResult::Processed);
+    EXPECT_EQ(results[1].status, FileResult::Unsupported);
+    EXPECT_EQ(results[1].message, "compressed (gzip) files are not supported");
+    EXPECT_EQ(results[2].status, FileResult::Processed);
+
+    // NDJSON stays one entry per line, the statistics entry last
+    std::ifstream lines("../data/sniffed/lines.json");
+    std::string line;
+    std::vector<std::string> entries;
+    while (std::getline(lines, line)) entries.push_back(line);
+    ASSERT_EQ(entries.size(), 3u);
+    EXPECT_EQ(entries[0], R"({"id":1,"value":4})");
+    EXPECT_NE(entries[2].find("\"mean\":6"), std::string::npos);
+
+    std::ifstream tabs("../data/sniffed/tabs.csv");
+    std::string content((std::istreambuf_iterator<char>(tabs)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(content, "id\tvalue\n1\t10\n2\t20\nmean\t15\nmedian\t15\nstd_dev\t5\n");
+
+    std::filesystem::remove_all("../data/sniffed");
+}
+
+TEST(DataGeneratorTest, OutputDependsOnlyOnOptions) {
+    auto generate = [](const GeneratorOptions& options) {
+        std::string path = "../data/generated.tmp";
+        EXPECT_TRUE(generateDataFile(path, options));
+        std::ifstream file(path);
+        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::remove(path.c_str());
+        return content;
+    };
+
+    GeneratorOptions options;
+    options.rows = 1000;
+    options.chunkRows = 64;
+    options.ids = IdDistribution::Zipf;
+    options.values = ValueDistribution::Normal;
+    options.nanRate = 0.05;
+    options.badRate = 0.05;
+    options.threads = 1;
+    std::string csv = generate(options);
+    options.threads = 4;
+    EXPECT_EQ(generate(options), csv);
+    options.seed = 2;
+    EXPECT_NE(generate(options), csv);
+
+    EXPECT_EQ(std::count(csv.begin(), csv.end(), '\n'), 1001);
+    EXPECT_EQ(csv.rfind("id,value\n", 0), 0u);
+    EXPECT_NE(csv.find(",nan\n"), std::string::npos);
+    EXPECT_NE(csv.find(",n/a\n"), std::string::npos);
+
+    // Chunks join into one valid document
+    options.format = FileFormat::Json;
+    nlohmann::json json = nlohmann::json::parse(generate(options));
+    ASSERT_EQ(json.size(), 1000u);
+    EXPECT_TRUE(json[0].contains("value"));
+
+    options.format = FileFormat::Ndjson;
+    options.rows = 0;
+    EXPECT_EQ(generate(options), "");
+}
+
+TEST(DataGeneratorTest, ZipfSamplerFollowsPowerLaw) {
+    ZipfSampler zipf(1000, 1.0);
+    std::mt19937_64 engine(7);
+    auto next = [&engine]() { return static_cast<double>(engine() >> 11) * 0x1.0p-53; };
+    std::vector<uint64_t> counts(1001, 0);
+    const int draws = 200000;
+    for (int i = 0; i < draws; ++i) {
+        uint64_t rank = zipf(next);
+        ASSERT_GE(rank, 1u);
+        ASSERT_LE(rank, 1000u);
+        ++counts[rank];
+    }
+    // P(k) = 1 / (k * H(1000)), H(1000) ~ 7.485
+    EXPECT_NEAR(counts[1] / double(draws), 1 / 7.485, 0.01);
+    EXPECT_NEAR(counts[2] / double(counts[1]), 0.5, 0.03);
+    EXPECT_NEAR(counts[10] / double(counts[1]), 0.1, 0.02);
+}
+
+TEST_F(FileHandlerTest, PooledHandlersAreResetBetweenFiles) {
+    std::ofstream("../data/reuse_a.csv") << "id,value\n1,10\n2,20\n3,30\n";
+    std::ofstream("../data/reuse_b.csv") << "id;value\n4;1\n5;3\n";
+    std::ofstream("../data/reuse_c.json") << R"([{"id": 1, "value": 4}, {"id": 2, "value": 8}])";
+    std::ofstream("../data/reuse_d.json") << R"([{"id": 3, "value": 1}])";
+    auto run = [](FileHandler& handler) {
+        handler.readData();
+        handler.process();
+        handler.writeData();
+        return handler.summary();
+    };
+
+    HandlerPool pool;
+    CsvFileHandlerCreator commas;
+    std::unique_ptr<FileHandler> handler = pool.acquire(commas, "../data/reuse_a.csv");
+    EXPECT_NE(run(*handler).find("\"mean\":20"), std::string::npos);
+    FileHandler* first = handler.get();
+    pool.release(commas, std::move(handler));
+
+    // Same handler, with the options of the creator that hands it out
+    ProcessingOptions options;
+    options.delimiter = ';';
+    CsvFileHandlerCreator semicolons(options);
+    handler = pool.acquire(semicolons, "../data/reuse_b.csv");
+    EXPECT_EQ(handler.get(), first);
+    EXPECT_NE(run(*handler).find("\"mean\":2"), std::string::npos);
+    std::ifstream file("../data/reuse_b.csv");
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(content, "id;value\n4;1\n5;3\nmean;2\nmedian;2\nstd_dev;1\n");
+
+    // Other handler types get their own spare
+    JsonFileHandlerCreator json;
+    std::unique_ptr<FileHandler> jsonHandler = pool.acquire(json, "../data/reuse_c.json");
+    EXPECT_NE(jsonHandler.get(), first);
+    EXPECT_NE(run(*jsonHandler).find("\"mean\":6"), std::string::npos);
+    pool.release(json, std::move(jsonHandler));
+    jsonHandler = pool.acquire(json, "../data/reuse_d.json");
+    EXPECT_NE(run(*jsonHandler).find("\"mean\":1"), std::string::npos);
+    EXPECT_FALSE(jsonHandler->summary().find("\"mean\":6") != std::string::npos);
+
+    for (const char* path : {"../data/reuse_a.csv", "../data/reuse_b.csv", "../data/reuse_c.json", "../data/reuse_d.json",
+                             "../data/reuse_a.csv.state", "../data/reuse_b.csv.state"}) {
+        std::remove(path);
+    }
+}
+
+TEST(DataProcessorCoreTest, ProcessesBuffersInMemory) {
+    // No state file records a footer for a buffer, so a row labelled like
+    // one is data
+    std::string csv = "id,value\n1,10\n2,20\n3,30\nmean,40\n";
+    StatisticsResult result = processBuffer(csv);
+    ASSERT_TRUE(result.succeeded) << result.error;
+    EXPECT_EQ(result.format, FileFormat::Csv);
+    ASSERT_TRUE(result.values.has_value());
+    EXPECT_DOUBLE_EQ(result.values->mean, 25);
+    EXPECT_DOUBLE_EQ(result.values->median, 25);
+    EXPECT_NE(result.json.find("\"mean\":25"), std::string::npos);
+
+    // Options that need every row parse the buffer through the row reader
+    ProcessingOptions options;
+    options.groupBy = true;
+    std::string tabs = "id\tvalue\n1\t1\n1\t3\n";
+    result = processBuffer(std::span<const char>(tabs.data(), tabs.size()), options);
+    ASSERT_TRUE(result.succeeded) << result.error;
+    EXPECT_DOUBLE_EQ(result.values->mean, 2);
+
+    std::string ndjson = "{\"id\": 1, \"value\": 4}\n{\"id\": 2, \"value\": 8}\n";
+    result = processBuffer(ndjson);
+    EXPECT_EQ(result.format, FileFormat::Ndjson);
+    EXPECT_DOUBLE_EQ(result.values->mean, 6);
+
+    options = ProcessingOptions();
+    options.allColumns = true;
+    result = processBuffer(std::string(R"([{"id": 1, "a": 1, "b": 5}, {"id": 2, "a": 3, "b": 7}])"), options);
+    ASSERT_TRUE(result.succeeded) << result.error;
+    EXPECT_FALSE(result.values.has_value());
+    EXPECT_NE(result.json.find("\"b\":{"), std::string::npos);
+
+    // Failures come back with the handler's own message; nothing is printed
+    testing::internal::CaptureStderr();
+    result = processBuffer(std::string("id,value\n1,abc\n"));
+    EXPECT_FALSE(result.succeeded);
+    EXPECT_EQ(result.error, "Invalid value in CSV file: abc");
+    // Out of range values are invalid data in the chunked and the row path alike
+    ProcessingOptions rows;
+    rows.groupBy = true;
+    for (const ProcessingOptions& pathOptions : {ProcessingOptions(), rows}) {
+        result = processBuffer(std::string("id,value\n1,1e999\n"), pathOptions);
+        EXPECT_FALSE(result.succeeded);
+        EXPECT_EQ(result.error, "Value out of range in CSV file: 1e999");
+    }
+    result = processBuffer(std::string("[{\"id\": 1,"));
+    EXPECT_FALSE(result.succeeded);
+    EXPECT_EQ(result.error.rfind("JSON parse error: ", 0), 0u) << result.error;
+    EXPECT_EQ(testing::internal::GetCapturedStderr(), "");
+    EXPECT_FALSE(processBuffer(std::string("\x1f\x8b\x08\x00", 4)).succeeded);
+}
+
+TEST(DataProcessorCoreTest, ProcessesStreams) {
+    std::istringstream csv("id,value\n1,2\n2,4\n");
+    StatisticsResult result = processStream(csv, FileFormat::Csv);
+    ASSERT_TRUE(result.succeeded) << result.error;
+    EXPECT_DOUBLE_EQ(result.values->mean, 3);
+
+    std::istringstream json(R"([{"id": 1, "value": 1}, {"id": 2, "value": 2}])");
+    result = processStream(json);
+    EXPECT_EQ(result.format, FileFormat::Json);
+    EXPECT_DOUBLE_EQ(result.values->std_dev, 0.5);
+}